@@ -0,0 +1,77 @@
+// One backend of `bin/multi.c`: the library and the command-line interface,
+// compiled for the integer type chosen by `-DBOOST_*_INT` and wrapped in the
+// namespace `BACKEND` so that several backends link into a single binary.
+
+#if !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+// system headers are included first, so that their guards keep them out of
+// the namespace below
+#include <assert.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <boost/multiprecision/cpp_bin_float.hpp>
+#include <boost/multiprecision/cpp_int.hpp>
+#if defined(BOOST_MPZ_INT)
+#include <boost/multiprecision/gmp.hpp>
+#elif defined(BOOST_TOM_INT)
+#include <boost/multiprecision/tommath.hpp>
+#endif
+
+#define main backend_main
+
+namespace BACKEND {
+#include "../src/batch.c"
+#include "../src/cache.c"
+#include "../src/colex.c"
+#include "../src/digest.c"
+#include "../src/gray.c"
+#include "../src/kernels.c"
+#include "../src/math.c"
+#include "../src/pack.c"
+#include "../src/paramset.c"
+#include "../src/pool.c"
+#include "../src/rbo.c"
+#include "../src/tail.c"
+#include "../src/utils.c"
+#include "../src/workspace.c"
+
+#include "cli.c"
+
+// bits that the arithmetic needs for the parameters in `argv`, or zero if
+// they are invalid, for `bin/multi.c` to pick the narrowest fixed width
+uint16_t backend_bits(int32_t argc, char **argv) {
+  uint16_t n = 0, k = 0, d = 0, m = 0;
+  uint32_t iterations = 1;
+  uint32_t seed = 0;
+  order ord = colex;
+  strategy_func strategy = mingen;
+  uint8_t format = U32_FORMAT;
+  const paramset_t *set = NULL;
+
+  if (parse_args(argc, argv, &n, &k, &d, &iterations, &ord, &m, &strategy,
+                 &seed, &format, &set) > 0 ||
+      n == 0) {
+    return 0;
+  }
+
+  return bits_fit_terms(n, k, d);
+}
+} // namespace BACKEND
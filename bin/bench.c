@@ -0,0 +1,447 @@
+#include <getopt.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "batch.h"
+#include "cache.h"
+#include "colex.h"
+#include "gray.h"
+#include "math.h"
+#include "utils.h"
+#include "workspace.h"
+
+// a slowdown is flagged when Welch's t exceeds this and the mean grew by more
+// than MIN_SLOWDOWN, so that neither noise nor negligible shifts count
+static const double T_CRITICAL = 3.0;
+static const double MIN_SLOWDOWN = 1.05;
+
+// each sample runs a primitive until this much time has passed
+static const long double SAMPLE_NS = 2e5;
+
+static const struct option long_options[] = {
+    {"iterations", required_argument, 0, 'i'},
+    {"compare", required_argument, 0, 'c'},
+    {"alloc", required_argument, 0, 'a'},
+    {0, 0, 0, 0},
+};
+
+static const char *help_text =
+    "Usage: %s [OPTIONS] [<m>-<k> ...]\n"
+    "  Time each math primitive and cache builder for the parameters chosen\n"
+    "  by `mingen` for each security level `m` and number of parts `k`, and\n"
+    "  print `backend primitive n k d samples mean_ns stddev_ns allocs` per\n"
+    "  line, the last being the calls to malloc per call of the primitive.\n"
+    "\n"
+    "  -i, --iterations=<uint32_t>\n"
+    "         Number of samples per primitive.\n"
+    "\n"
+    "  -c, --compare=<file>\n"
+    "         Compare against a baseline printed by a previous run, marking\n"
+    "         and failing on significant slowdowns.\n"
+    "\n"
+    "  -a, --alloc=<pool|system>\n"
+    "         Where heap-backed integers take their limbs from: the pools\n"
+    "         (default), or malloc for every one of them.\n";
+
+static const char *DEFAULT_PARAMS[] = {"128-32", "128-64", "256-32",
+                                       "256-64"};
+
+// keeps the results alive, so that no primitive is optimized away
+static volatile uint64_t sink;
+
+// #C(n, k, d) for the parameters being timed, the input of `lg`
+static uintx count;
+
+// BATCH_LANES random ranks for the parameters being timed, unranked one by one
+// or in lockstep from `batch`, which is rebuilt whenever they change
+static batch_t batch;
+static uintx ranks[BATCH_LANES];
+static uint64_t *sliced;
+static uint32_t *parts;
+// and their compositions in colex and Gray order, to time ranking alone
+static uint32_t *colex_parts;
+static uint32_t *gray_parts;
+
+void consume(uintx_cref x) { sink = sink + (uint64_t)(x & UINT64_MAX); }
+
+typedef void (*primitive_func)(const uint16_t, const uint16_t, const uint16_t,
+                               workspace_t *);
+
+typedef struct {
+  const char *name;
+  primitive_func func;
+  // caches below this one are built before timing, and this one is built
+  // and freed by `time_build_cache` on every call
+  int cache;
+} primitive_t;
+
+void time_inner_bin(const uint16_t n, const uint16_t k, const uint16_t d,
+                    workspace_t *ws) {
+  (void)ws;
+  consume(inner_bin(n + k - 1, k - 1, d));
+}
+
+void time_inner_bic_with_sums(const uint16_t n, const uint16_t k,
+                              const uint16_t d, workspace_t *ws) {
+  consume(inner_bic_with_sums(n, k, d, ws->partial_sums, bin));
+}
+
+void time_bic_acc(const uint16_t n, const uint16_t k, const uint16_t d,
+                  workspace_t *ws) {
+  (void)ws;
+  consume(bic_acc(n, k, d, d / 2));
+}
+
+void time_inner_acc(const uint16_t n, const uint16_t k, const uint16_t d,
+                    workspace_t *ws) {
+  consume(inner_acc(ws->sums, n, k, d)[d / 2]);
+}
+
+void time_lg(const uint16_t n, const uint16_t k, const uint16_t d,
+             workspace_t *ws) {
+  (void)n;
+  (void)k;
+  (void)d;
+  (void)ws;
+  sink = sink + (uint64_t)lg(count);
+}
+
+void time_build_cache(const uint16_t n, const uint16_t k, const uint16_t d,
+                      workspace_t *ws) {
+  (void)ws;
+  cache_builders[cache_type](n, k, d);
+  cache_demolishers[cache_type]();
+}
+
+void setup_batch(const uint16_t n, const uint16_t k, const uint16_t d,
+                 workspace_t *ws) {
+  if (batch.sums != NULL && batch.n == n && batch.k == k && batch.d == d) {
+    return;
+  }
+
+  free_batch(&batch);
+  free(sliced);
+  free(parts);
+  free(colex_parts);
+  free(gray_parts);
+  build_batch(&batch, n, k, d);
+  sliced = (uint64_t *)calloc(batch.limbs * BATCH_LANES, sizeof(uint64_t));
+  parts = (uint32_t *)calloc(k * BATCH_LANES, sizeof(uint32_t));
+  colex_parts = (uint32_t *)calloc(k * BATCH_LANES, sizeof(uint32_t));
+  gray_parts = (uint32_t *)calloc(k * BATCH_LANES, sizeof(uint32_t));
+  assert(sliced != NULL && parts != NULL);
+  assert(colex_parts != NULL && gray_parts != NULL);
+
+  for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+    ranks[l] = random_rank(n, k, d, ws);
+    colex_unrank(colex_parts + l * k, n, k, d, ranks[l], ws);
+    gray_unrank(gray_parts + l * k, n, k, d, ranks[l], ws);
+  }
+}
+
+void time_unrank_scalar(const uint16_t n, const uint16_t k, const uint16_t d,
+                        workspace_t *ws) {
+  setup_batch(n, k, d, ws);
+  for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+    colex_unrank_acc_linear(parts, n, k, d, ranks[l], ws);
+  }
+  sink = sink + parts[0];
+}
+
+void time_unrank_batch(const uint16_t n, const uint16_t k, const uint16_t d,
+                       workspace_t *ws) {
+  setup_batch(n, k, d, ws);
+  batch_import(&batch, sliced, ranks);
+  batch_unrank(&batch, parts, sliced);
+  sink = sink + parts[0];
+}
+
+void time_rank_scalar(const uint16_t n, const uint16_t k, const uint16_t d,
+                      workspace_t *ws) {
+  setup_batch(n, k, d, ws);
+  for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+    colex_unrank_acc_linear(parts, n, k, d, ranks[l], ws);
+    consume(colex_rank(n, k, d, parts));
+  }
+}
+
+void time_rank_batch(const uint16_t n, const uint16_t k, const uint16_t d,
+                     workspace_t *ws) {
+  setup_batch(n, k, d, ws);
+  batch_import(&batch, sliced, ranks);
+  batch_unrank(&batch, parts, sliced);
+  batch_rank(&batch, sliced, parts);
+  sink = sink + sliced[0];
+}
+
+void time_colex_rank(const uint16_t n, const uint16_t k, const uint16_t d,
+                     workspace_t *ws) {
+  setup_batch(n, k, d, ws);
+  for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+    consume(colex_rank(n, k, d, colex_parts + l * k));
+  }
+}
+
+void time_gray_rank(const uint16_t n, const uint16_t k, const uint16_t d,
+                    workspace_t *ws) {
+  setup_batch(n, k, d, ws);
+  for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+    consume(gray_rank(n, k, d, gray_parts + l * k));
+  }
+}
+
+// past the last cache, every one is built and none is timed
+static const primitive_t PRIMITIVES[] = {
+    {"inner_bin", time_inner_bin, NO_CACHE},
+    {"inner_bic_with_sums", time_inner_bic_with_sums, NO_CACHE},
+    {"bic_acc", time_bic_acc, NO_CACHE},
+    {"inner_acc", time_inner_acc, NO_CACHE},
+    {"lg", time_lg, NO_CACHE},
+    {"bin_build_cache", time_build_cache, BIN_CACHE},
+    {"comb_build_cache", time_build_cache, COMB_CACHE},
+    {"scomb_build_cache", time_build_cache, SMALL_COMB_CACHE},
+    {"acc_build_cache", time_build_cache, ACC_COMB_CACHE},
+    // BATCH_LANES ranks per call, so that scalar and batch times compare
+    {"unrank_acc_linear_x8", time_unrank_scalar, SENTINEL_LENGTH},
+    {"batch_unrank", time_unrank_batch, SENTINEL_LENGTH},
+    {"unrank_rank_x8", time_rank_scalar, SENTINEL_LENGTH},
+    {"batch_unrank_rank", time_rank_batch, SENTINEL_LENGTH},
+    {"colex_rank_x8", time_colex_rank, SENTINEL_LENGTH},
+    {"gray_rank_x8", time_gray_rank, SENTINEL_LENGTH},
+};
+
+typedef struct {
+  char backend[16];
+  char name[32];
+  uint32_t n;
+  uint32_t k;
+  uint32_t d;
+  uint32_t samples;
+  double mean;
+  double sd;
+  double allocs;
+} result_t;
+
+// Newton's method, so that the benchmark needs no `libm`
+double square_root(const double x) {
+  double r = (x > 1) ? x : 1;
+  for (uint32_t i = 0; i < 64 && r * r - x > 1e-12 * x; ++i) {
+    r = (r + x / r) / 2;
+  }
+  return (x > 0) ? r : 0;
+}
+
+long double elapsed_ns(const struct timespec *start,
+                       const struct timespec *stop) {
+  return (long double)(stop->tv_sec - start->tv_sec) * NS_TO_SEC +
+         (long double)(stop->tv_nsec - start->tv_nsec);
+}
+
+// mean and standard deviation of the time per call over `samples` samples
+void run_primitive(const primitive_t *p, const uint16_t n, const uint16_t k,
+                   const uint16_t d, const uint32_t samples, result_t *res) {
+  workspace_t ws;
+  setup_workspace(&ws, n, k, d);
+  count = inner_bic_with_sums(n, k, d, NULL, pascal);
+
+  // the caches below the one timed are built once, outside of the samples
+  cache_type = min(p->cache, ACC_COMB_CACHE);
+  for (int c = BIN_CACHE; c < p->cache; ++c) {
+    cache_builders[c](n, k, d);
+  }
+
+  long double sum = 0;
+  long double squares = 0;
+  uint64_t calls = 0;
+  size_t allocs = 0;
+
+  // calibrate the calls per sample with the first one, which is discarded
+  for (uint32_t s = 0; s <= samples; ++s) {
+    struct timespec start, stop;
+    const uint64_t reps = calls;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+    if (s == 0) {
+      do {
+        (*p->func)(n, k, d, &ws);
+        ++calls;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &stop);
+      } while (elapsed_ns(&start, &stop) < SAMPLE_NS);
+      allocs = system_allocations;
+      continue;
+    }
+    for (uint64_t r = 0; r < reps; ++r) {
+      (*p->func)(n, k, d, &ws);
+    }
+    clock_gettime(CLOCK_MONOTONIC_RAW, &stop);
+
+    long double per_call = elapsed_ns(&start, &stop) / reps;
+    sum += per_call;
+    squares += per_call * per_call;
+  }
+
+  allocs = system_allocations - allocs;
+
+  for (int c = p->cache - 1; c >= BIN_CACHE; --c) {
+    cache_demolishers[c]();
+  }
+  cache_type = NO_CACHE;
+  free_workspace(&ws);
+
+  long double mean = sum / samples;
+  long double var = (samples > 1)
+                        ? (squares - samples * mean * mean) / (samples - 1)
+                        : 0;
+
+  snprintf(res->backend, sizeof(res->backend), "%s", BACKEND_NAME);
+  snprintf(res->name, sizeof(res->name), "%s", p->name);
+  res->n = n;
+  res->k = k;
+  res->d = d;
+  res->samples = samples;
+  res->mean = (double)mean;
+  res->sd = square_root((double)var);
+  res->allocs = (double)allocs / (calls * samples);
+}
+
+// Welch's t statistic of `now` being slower than `base`
+double welch_t(const result_t *now, const result_t *base) {
+  double se = square_root(now->sd * now->sd / now->samples +
+                          base->sd * base->sd / base->samples);
+  return (se > 0) ? (now->mean - base->mean) / se : 0;
+}
+
+// the entry of `baseline` for the same backend, primitive and parameters
+const result_t *find_result(const result_t *baseline, const size_t length,
+                            const result_t *res) {
+  for (size_t i = 0; i < length; ++i) {
+    const result_t *b = &baseline[i];
+    if (strcmp(b->backend, res->backend) == 0 &&
+        strcmp(b->name, res->name) == 0 && b->n == res->n && b->k == res->k &&
+        b->d == res->d) {
+      return b;
+    }
+  }
+  return NULL;
+}
+
+size_t read_baseline(const char *path, result_t **baseline) {
+  FILE *f = fopen(path, "r");
+  size_t length = 0;
+  size_t capacity = 64;
+  *baseline = (result_t *)calloc(capacity, sizeof(result_t));
+  assert(*baseline != NULL);
+
+  if (f == NULL) {
+    return 0;
+  }
+
+  // lines that do not parse, such as comments, are skipped
+  char line[256];
+  while (fgets(line, sizeof(line), f) != NULL) {
+    result_t r;
+    if (sscanf(line, "%15s %31s %u %u %u %u %lf %lf", r.backend, r.name, &r.n,
+               &r.k, &r.d, &r.samples, &r.mean, &r.sd) != 8) {
+      continue;
+    }
+    if (length == capacity) {
+      capacity *= 2;
+      *baseline =
+          (result_t *)realloc(*baseline, capacity * sizeof(result_t));
+      assert(*baseline != NULL);
+    }
+    (*baseline)[length++] = r;
+  }
+
+  fclose(f);
+  return length;
+}
+
+int32_t main(int32_t argc, char **argv) {
+  uint32_t samples = 16;
+  const char *compare = NULL;
+
+  while (1) {
+    int c = getopt_long(argc, argv, "i:c:a:", long_options, NULL);
+    if (c == -1) {
+      break;
+    }
+
+    switch (c) {
+    case 'i':
+      samples = max(strtoul(optarg, NULL, 10), 2);
+      break;
+    case 'c':
+      compare = optarg;
+      break;
+    case 'a':
+      if (strcmp(optarg, "system") == 0) {
+        alloc_mode = SYSTEM_ALLOC;
+      } else if (strcmp(optarg, "pool") != 0) {
+        fprintf(stderr, help_text, argv[0]);
+        return 1;
+      }
+      break;
+    default:
+      fprintf(stderr, help_text, argv[0]);
+      return 1;
+    }
+  }
+
+  const char **params = (const char **)(argv + optind);
+  size_t num_params = argc - optind;
+  if (num_params == 0) {
+    params = DEFAULT_PARAMS;
+    num_params = sizeof(DEFAULT_PARAMS) / sizeof(const char *);
+  }
+
+  result_t *baseline = NULL;
+  size_t baseline_length = (compare) ? read_baseline(compare, &baseline) : 0;
+  uint32_t slowdowns = 0;
+
+  for (size_t i = 0; i < num_params; ++i) {
+    uint16_t m = 0, n = 0, k = 0, d = 0;
+    if (sscanf(params[i], "%hu-%hu", &m, &k) != 2) {
+      fprintf(stderr, help_text, argv[0]);
+      free(baseline);
+      return 1;
+    }
+    mingen(m, &n, k, &d);
+
+    for (size_t p = 0; p < sizeof(PRIMITIVES) / sizeof(primitive_t); ++p) {
+      result_t res;
+      run_primitive(&PRIMITIVES[p], n, k, d, samples, &res);
+      printf("%-10s %-20s %5u %5u %5u %5u %14.2f %14.2f %8.2f", res.backend,
+             res.name, res.n, res.k, res.d, res.samples, res.mean, res.sd,
+             res.allocs);
+
+      const result_t *base =
+          (compare) ? find_result(baseline, baseline_length, &res) : NULL;
+      if (base != NULL) {
+        double t = welch_t(&res, base);
+        bool slower = t > T_CRITICAL && res.mean > MIN_SLOWDOWN * base->mean;
+        printf(" # %+7.1f%% t = %+7.2f%s", 100 * (res.mean / base->mean - 1),
+               t, (slower) ? " SLOWER" : "");
+        slowdowns += slower;
+      }
+      printf("\n");
+      fflush(stdout);
+    }
+  }
+
+  free(baseline);
+  free_batch(&batch);
+  free(sliced);
+  free(parts);
+  free(colex_parts);
+  free(gray_parts);
+
+  if (slowdowns > 0) {
+    fprintf(stderr, "%u significant slowdowns against %s\n", slowdowns,
+            compare);
+    return 1;
+  }
+
+  return 0;
+}
@@ -5,10 +5,16 @@
 
 #include "cache.h"
 #include "colex.h"
+#include "digest.h"
 #include "gray.h"
+#include "kernels.h"
 #include "math.h"
+#include "pack.h"
+#include "paramset.h"
 #include "rbo.h"
+#include "tail.h"
 #include "utils.h"
+#include "workspace.h"
 
 #define INVALID_PARAM                                                          \
   if (fprintf(stderr, "Invalid parameter.\n")) {                               \
@@ -26,6 +32,14 @@ static const struct option long_options[] = {
     {"target", required_argument, 0, 'm'},
     {"strategy", required_argument, 0, 's'},
     {"randomness", required_argument, 0, 'r'},
+    {"layout", required_argument, 0, 'l'},
+    {"format", required_argument, 0, 'f'},
+    {"paramset", required_argument, 0, 'p'},
+    {"generic", no_argument, 0, 'g'},
+    {"pages", required_argument, 0, 't'},
+    {"fill", required_argument, 0, 'y'},
+    {"tail", required_argument, 0, 'e'},
+    {"sums", required_argument, 0, 'u'},
     {0, 0, 0, 0},
 };
 
@@ -62,7 +76,9 @@ static const char *help_text =
     "           * `ab` (binary search over a pre-calculated array of\n"
     "               accumulated sums of #C(n, k, d));\n"
     "           * `ad` (binary search over accumulated sums of #C(n, k, d)\n"
-    "               calculated directly on demand).\n"
+    "               calculated directly on demand);\n"
+    "           * `ai` (interpolation guess over a pre-calculated array of\n"
+    "               accumulated sums of #C(n, k, d)).\n"
     "\n"
     "  -i, --iterations=<uint32_t>\n"
     "         Number to repeatedly unrank random integers.\n"
@@ -84,24 +100,91 @@ static const char *help_text =
     "           * `ver` (minimize `n` at all costs).\n"
     "\n"
     "  -r, --randomness=<uint32_t>\n"
-    "         Set the seed for the random number generator.\n";
+    "         Set the seed for the random number generator.\n"
+    "\n"
+    "  -l, --layout=<lay>\n"
+    "         Use <lay> to store the #C(n, k, d) cache.\n"
+    "         Available options are:\n"
+    "           * `row` (full row-major table);\n"
+    "           * `band` (reachable band only, folded by symmetry);\n"
+    "           * `column` (full column-major table);\n"
+    "           * `tiled` (full table in 8 by 8 tiles).\n"
+    "\n"
+    "  -f, --format=<fmt>\n"
+    "         Use <fmt> to store each part of the composition.\n"
+    "         Available options are:\n"
+    "           * `u32` (32-bit integers);\n"
+    "           * `u16` (16-bit integers);\n"
+    "           * `u8` (8-bit integers);\n"
+    "           * `bit` (packed to the bit length of `d`);\n"
+    "           * `auto` (narrowest of `u8` or `u16` that fits `d`).\n"
+    "\n"
+    "  -p, --paramset=<m>-<k>\n"
+    "         Use the tables generated by `make tables` for `m` and `k`\n"
+    "         instead of computing the caches.\n"
+    "\n"
+    "  -g, --generic\n"
+    "         Use the generic unranking code even if `d` is small enough\n"
+    "         for a specialized kernel.\n"
+    "\n"
+    "  -t, --pages=<pg>\n"
+    "         Use <pg> to back the caches.\n"
+    "         Available options are:\n"
+    "           * `base` (regular pages from the heap);\n"
+    "           * `huge` (2 MiB pages, explicit if reserved and transparent\n"
+    "               otherwise, falling back to `base`).\n"
+    "\n"
+    "  -y, --fill=<mode>\n"
+    "         Use <mode> to fill the `comb` and `acc` caches.\n"
+    "         Available options are:\n"
+    "           * `eager` (every cell when starting);\n"
+    "           * `lazy` (each cell when first accessed, reporting how many\n"
+    "               were).\n"
+    "\n"
+    "  -e, --tail=<uint32_t>\n"
+    "         Spend up to this many KiB on tables that give the last parts\n"
+    "         of a `colex` or `gray` unranking in one lookup.\n"
+    "\n"
+    "  -u, --sums=<mode>\n"
+    "         Use <mode> to store the `acc` cache.\n"
+    "         Available options are:\n"
+    "           * `rows` (the d + 3 accumulated sums of each (n, k));\n"
+    "           * `prefix` (one prefix sum of #C(n, k, d) per (n, k), from\n"
+    "               which each accumulated sum is a difference, always filled\n"
+    "               eagerly).\n";
 
 void pprint(const uint16_t n, const uint16_t k, const uint16_t d,
             const uint32_t it, const long double utime,
             const long double ucycles, const long double rtime,
-            const long double rcycles) {
+            const long double rcycles, const size_t page_size,
+            const long double misses, const long double l1d_misses) {
   printf("n = %5d, k = %5d, d = %5d, i = %5u, m = %10.4Lf, b = %5f, c = %2u, "
          "unrank avg = %14.2Lf ns, %14.2Lf cyc., "
-         "rank avg = %14.2Lf ns, %14.2Lf cyc.\n",
-         n, k, d, it, bits_fit_bic(n, k, d), BIT_LENGTH, cache_type, utime / it,
-         ucycles / it, rtime / it, rcycles / it);
+         "rank avg = %14.2Lf ns, %14.2Lf cyc., "
+         "page = %6zu KiB, dtlb avg = %12.2Lf miss., "
+         "l1d avg = %12.2Lf miss.\n",
+         n, k, d, it, (long double)bits_fit_bic(n, k, d), BIT_LENGTH,
+         cache_type, utime / it, ucycles / it, rtime / it, rcycles / it,
+         page_size / 1024, misses / it, l1d_misses / it);
+}
+
+void print_fills(void) {
+  const cache_t *caches[] = {&comb_cache_t, &acc_cache_t};
+  for (size_t i = 0; i < sizeof(caches) / sizeof(cache_t *); ++i) {
+    if (cache_type >= caches[i]->type && caches[i]->state != NULL) {
+      printf("%s: filled = %zu of %zu cells\n", caches[i]->name,
+             caches[i]->filled, caches[i]->cells);
+    }
+  }
 }
 
 int32_t parse_args(int32_t argc, char **argv, uint16_t *n, uint16_t *k,
                    uint16_t *d, uint32_t *iterations, order *ord, uint16_t *m,
-                   strategy_func *strategy, uint32_t *seed) {
+                   strategy_func *strategy, uint32_t *seed,
+                   uint8_t *format, const paramset_t **set) {
   for (;;) {
-    int c = getopt_long(argc, argv, "n:k:d:o:a:i:c:m:s:r:", long_options, NULL);
+    int c = getopt_long(argc, argv, "n:k:d:o:a:i:c:m:s:r:l:f:p:gt:y:e:u:",
+                        long_options, NULL);
     if (c == -1) {
       break;
     }
@@ -139,12 +222,17 @@ int32_t parse_args(int32_t argc, char **argv, uint16_t *n, uint16_t *k,
         (*ord).unrank = colex_unrank_part_sums;
       } else if (strcmp(optarg, "ad") == 0) {
         (*ord).unrank = colex_unrank_acc_direct;
+      } else if (strcmp(optarg, "ai") == 0) {
+        (*ord).unrank = colex_unrank_acc_interp;
       } else
         INVALID_PARAM;
       break;
     case 'i':
       *iterations = strtol(optarg, NULL, 0);
       break;
+    case 'e':
+      tail_budget = strtol(optarg, NULL, 0);
+      break;
     case 'c':
       if (strcmp(optarg, "none") == 0) {
         cache_type = NO_CACHE;
@@ -173,6 +261,67 @@ int32_t parse_args(int32_t argc, char **argv, uint16_t *n, uint16_t *k,
     case 'r':
       *seed = strtol(optarg, NULL, 0);
       break;
+    case 'l':
+      if (strcmp(optarg, "row") == 0) {
+        cache_layout = ROW_MAJOR_LAYOUT;
+      } else if (strcmp(optarg, "band") == 0) {
+        cache_layout = BAND_LAYOUT;
+      } else if (strcmp(optarg, "column") == 0) {
+        cache_layout = COLUMN_MAJOR_LAYOUT;
+      } else if (strcmp(optarg, "tiled") == 0) {
+        cache_layout = TILED_LAYOUT;
+      } else
+        INVALID_PARAM;
+      break;
+    case 'f':
+      if (strcmp(optarg, "u32") == 0) {
+        *format = U32_FORMAT;
+      } else if (strcmp(optarg, "u16") == 0) {
+        *format = U16_FORMAT;
+      } else if (strcmp(optarg, "u8") == 0) {
+        *format = U8_FORMAT;
+      } else if (strcmp(optarg, "bit") == 0) {
+        *format = BIT_FORMAT;
+      } else if (strcmp(optarg, "auto") == 0) {
+        *format = AUTO_FORMAT;
+      } else
+        INVALID_PARAM;
+      break;
+    case 'p':
+      *set = find_paramset(optarg);
+      if (*set == NULL)
+        INVALID_PARAM;
+      *n = (*set)->n;
+      *k = (*set)->k;
+      *d = (*set)->d;
+      break;
+    case 'g':
+      kernel_mode = GENERIC_KERNELS;
+      break;
+    case 'y':
+      if (strcmp(optarg, "eager") == 0) {
+        cache_fill = EAGER_FILL;
+      } else if (strcmp(optarg, "lazy") == 0) {
+        cache_fill = LAZY_FILL;
+      } else
+        INVALID_PARAM;
+      break;
+    case 'u':
+      if (strcmp(optarg, "rows") == 0) {
+        cache_sums = ROW_SUMS;
+      } else if (strcmp(optarg, "prefix") == 0) {
+        cache_sums = PREFIX_SUMS;
+      } else
+        INVALID_PARAM;
+      break;
+    case 't':
+      if (strcmp(optarg, "base") == 0) {
+        cache_pages = BASE_PAGES;
+      } else if (strcmp(optarg, "huge") == 0) {
+        cache_pages = HUGE_PAGES;
+      } else
+        INVALID_PARAM;
+      break;
     default:
       return 1;
     }
@@ -186,6 +335,12 @@ int32_t parse_args(int32_t argc, char **argv, uint16_t *n, uint16_t *k,
     }
   } else if (*k * *d < *n) {
     INVALID_PARAM;
+  } else if (*format == U8_FORMAT && *d > UINT8_MAX) {
+    INVALID_PARAM;
+  }
+
+  if (*format == AUTO_FORMAT) {
+    *format = select_format(*d);
   }
 
   return 0;
@@ -200,15 +355,26 @@ int32_t main(int32_t argc, char **argv) {
   uint32_t seed = time(NULL);
   order ord = colex;
   strategy_func strategy = mingen;
+  uint8_t format = U32_FORMAT;
+  const paramset_t *set = NULL;
 
   if (parse_args(argc, argv, &n, &k, &d, &iterations, &ord, &m, &strategy,
-                 &seed) > 0) {
+                 &seed, &format, &set) > 0) {
     return 1;
   }
 
   srandom(seed);
 
-  build_caches(n, k, d);
+  ord = specialize_order(ord, d);
+
+  if (set != NULL) {
+    load_caches(set);
+  } else {
+    build_caches(n, k, d);
+  }
+
+  workspace_t ws;
+  setup_workspace(&ws, n, k, d);
 
   long double utime = 0;
   long double ucycles = 0;
@@ -216,26 +382,55 @@ int32_t main(int32_t argc, char **argv) {
   long double rtime = 0;
   long double rcycles = 0;
 
-  uint32_t *comp = (uint32_t *)malloc(k * sizeof(uint32_t));
+  size_t length = packed_size(k, d, format);
+  void *comp = malloc(length);
+
+  int32_t dtlb = open_dtlb_misses();
+  int64_t dtlb_start = read_misses(dtlb);
+  int32_t l1d = open_l1d_misses();
+  int64_t l1d_start = read_misses(l1d);
 
   for (uint32_t it = 0; it < iterations; ++it) {
-    memset(comp, 0, k * sizeof(uint32_t));
+    memset(comp, 0, length);
 
-    const uintx r = random_rank(n, k, d);
+    const uintx r = random_rank(n, k, d, &ws);
 
-    PERF(utime, ucycles, (*ord.unrank)(comp, n, k, d, r), unrank);
+    PERF(utime, ucycles, packed_unrank(&ord, comp, n, k, d, r, format, &ws),
+         unrank);
 
-    PERF(rtime, rcycles, const uintx rr = (*ord.rank)(n, k, d, comp), rank);
+    PERF(rtime, rcycles,
+         const uintx rr = packed_rank(&ord, comp, n, k, d, format, &ws), rank);
 
     assert(r == rr);
 
-    check_valid_bounded_composition(comp, n, k, d);
+    check_valid_packed_composition(comp, n, k, d, format);
+
+    // the random rank was reduced from a digest, which it must export to
+    unpack_composition(ws.parts, comp, k, d, format);
+    rank_to_bytes(&ord, ws.bytes, ws.bytes_length, n, k, d, ws.parts);
+    assert(reduce_rank(ws.bytes, ws.bytes_length, &ws) == r);
   }
 
-  pprint(n, k, d, iterations, utime, ucycles, rtime, rcycles);
+  int64_t l1d_stop = read_misses(l1d);
+  close_misses(l1d);
+  int64_t dtlb_stop = read_misses(dtlb);
+  close_misses(dtlb);
+
+  long double misses = (dtlb_start < 0 || dtlb_stop < 0)
+                           ? -1.0L * iterations
+                           : (long double)(dtlb_stop - dtlb_start);
+  long double l1d_misses = (l1d_start < 0 || l1d_stop < 0)
+                               ? -1.0L * iterations
+                               : (long double)(l1d_stop - l1d_start);
+
+  pprint(n, k, d, iterations, utime, ucycles, rtime, rcycles,
+         caches_page_size(), misses, l1d_misses);
+  print_fills();
 
   free_caches();
 
+  free_workspace(&ws);
+
   free(comp);
 
   return 0;
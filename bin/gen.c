@@ -0,0 +1,137 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cache.h"
+#include "math.h"
+#include "utils.h"
+
+static const char *help_text =
+    "Usage: %s <m>-<k> [<m>-<k> ...]\n"
+    "  Print pre-computed cache tables for each security level `m` and\n"
+    "  number of parts `k`, with `n` and `d` chosen by `mingen`.\n";
+
+void print_uintx(FILE *out, uintx_cref u) {
+  uint64_t limbs[64];
+  uint8_t length = 0;
+  for (uintx v = u; v > 0; v >>= 64) {
+    limbs[length++] = (uint64_t)(v & UINT64_MAX);
+  }
+
+  if (length <= 1) {
+    fprintf(out, "(uintx)0x%" PRIx64 "U", (length > 0) ? limbs[0] : 0);
+    return;
+  }
+
+  for (uint8_t i = 1; i < length; ++i) {
+    fprintf(out, "LIMB(");
+  }
+  fprintf(out, "0x%" PRIx64 "U", limbs[length - 1]);
+  for (uint8_t i = length - 1; i > 0; --i) {
+    fprintf(out, ", 0x%" PRIx64 "U)", limbs[i - 1]);
+  }
+}
+
+// `length` is the size of each cell for caches of arrays, or zero
+uint16_t print_table(FILE *out, const char *name, const char *suffix,
+                     const cache_t *c, const uint16_t length) {
+  uint16_t bits = 0;
+
+  fprintf(out, "TABLE uintx %s_%s[] = {\n", name, suffix);
+  for (uint32_t row = 0; row < c->rows; ++row) {
+    for (uint32_t col = 0; col < c->cols; ++col) {
+      const uintx *cell = (const uintx *)cache_get_element(c, row, col);
+      if (length > 0) {
+        cell = *(const uintx *const *)cell;
+      }
+      for (uint16_t i = 0; i < max(length, 1); ++i) {
+        fprintf(out, "    ");
+        print_uintx(out, cell[i]);
+        fprintf(out, ",\n");
+        bits = max(bits, 1 + (int32_t)lg(cell[i]));
+      }
+    }
+  }
+  fprintf(out, "};\n\n");
+
+  return bits;
+}
+
+void copy_to_stdout(FILE *f) {
+  char buffer[4096];
+  rewind(f);
+  for (size_t len; (len = fread(buffer, 1, sizeof(buffer), f)) > 0;) {
+    fwrite(buffer, 1, len, stdout);
+  }
+}
+
+int32_t main(int32_t argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, help_text, argv[0]);
+    return 1;
+  }
+
+  // tables go to a temporary file first, as their width guards the output
+  FILE *out = tmpfile();
+  assert(out != NULL);
+  uint16_t bits = 0;
+
+  uint16_t *params = (uint16_t *)calloc(4 * argc, sizeof(uint16_t));
+  assert(params != NULL);
+
+  cache_type = ACC_COMB_CACHE;
+  cache_layout = ROW_MAJOR_LAYOUT;
+
+  for (int32_t i = 1; i < argc; ++i) {
+    uint16_t *m = &params[4 * i];
+    uint16_t *n = &params[4 * i + 1];
+    uint16_t *k = &params[4 * i + 2];
+    uint16_t *d = &params[4 * i + 3];
+    if (sscanf(argv[i], "%hu-%hu", m, k) != 2) {
+      fprintf(stderr, help_text, argv[0]);
+      return 1;
+    }
+    mingen(*m, n, *k, d);
+
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "%hu_%hu", *m, *k);
+
+    build_caches(*n, *k, *d);
+    bits = max(bits, print_table(out, "bin", suffix, &bin_cache_t, 0));
+    bits = max(bits, print_table(out, "comb", suffix, &comb_cache_t, 0));
+    bits = max(bits,
+               print_table(out, "acc_data", suffix, &acc_cache_t, *d + 3));
+    free_caches();
+
+    fprintf(out, "static const uintx *const acc_%s[] = {\n", suffix);
+    for (uint32_t j = 0; j < (uint32_t)(*n + 1) * *k; ++j) {
+      fprintf(out, "    acc_data_%s + %u,\n", suffix, j * (*d + 3));
+    }
+    fprintf(out, "};\n\n");
+  }
+
+  printf("// generated by bin/gen.c, do not edit\n\n");
+  printf("#if (defined(BITINT) && BITINT >= %hu)", bits);
+  if (bits <= 512) {
+    printf(" || defined(BOOST_FIX_INT)");
+  }
+  printf(" ||\n    (defined(BOOST_UINT_INT) && BOOST_UINT_INT >= %hu)", bits);
+  printf("\n#define PARAMSETS_AVAILABLE\n\n");
+
+  copy_to_stdout(out);
+  fclose(out);
+
+  printf("const paramset_t PARAMSETS[] = {\n");
+  for (int32_t i = 1; i < argc; ++i) {
+    uint16_t *p = &params[4 * i];
+    printf("    {\"%hu-%hu\", %hu, %hu, %hu, ", p[0], p[2], p[1], p[2], p[3]);
+    printf("bin_%hu_%hu, comb_%hu_%hu, acc_%hu_%hu},\n", p[0], p[2], p[0],
+           p[2], p[0], p[2]);
+  }
+  printf("    {NULL, 0, 0, 0, NULL, NULL, NULL},\n};\n\n");
+  printf("#endif\n");
+
+  free(params);
+
+  return 0;
+}
@@ -0,0 +1,204 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <getopt.h>
+
+// every backend in `bin/backend.c` is compiled under its own namespace
+#define DECLARE_BACKEND(ns)                                                    \
+  namespace ns {                                                               \
+  int32_t backend_main(int32_t argc, char **argv);                             \
+  uint16_t backend_bits(int32_t argc, char **argv);                            \
+  }
+
+#if defined(WITH_FIX)
+DECLARE_BACKEND(bic_fix)
+#endif
+#if defined(WITH_ARB)
+DECLARE_BACKEND(bic_arb)
+#endif
+#if defined(WITH_MPZ)
+DECLARE_BACKEND(bic_mpz)
+#endif
+#if defined(WITH_TOM)
+DECLARE_BACKEND(bic_tom)
+#endif
+#if defined(WITH_U128)
+DECLARE_BACKEND(bic_u128)
+#endif
+#if defined(WITH_U192)
+DECLARE_BACKEND(bic_u192)
+#endif
+#if defined(WITH_U256)
+DECLARE_BACKEND(bic_u256)
+#endif
+#if defined(WITH_U320)
+DECLARE_BACKEND(bic_u320)
+#endif
+#if defined(WITH_U512)
+DECLARE_BACKEND(bic_u512)
+#endif
+
+#if defined(WITH_U128) || defined(WITH_U192) || defined(WITH_U256) ||          \
+    defined(WITH_U320) || defined(WITH_U512)
+#if !defined(WITH_ARB)
+#error "unchecked widths need boost-arb to bound their parameters"
+#endif
+#define WITH_WIDTHS
+#endif
+
+typedef struct {
+  const char *name;
+  int32_t (*main)(int32_t, char **);
+  // bits of an unchecked fixed-width backend, or zero for the others
+  uint16_t width;
+} backend_t;
+
+// unchecked widths are kept in increasing order, for `auto` to take the first
+// one that fits
+static const backend_t BACKENDS[] = {
+#if defined(WITH_FIX)
+    {"boost-fix", bic_fix::backend_main, 0},
+#endif
+#if defined(WITH_ARB)
+    {"boost-arb", bic_arb::backend_main, 0},
+#endif
+#if defined(WITH_MPZ)
+    {"mpz", bic_mpz::backend_main, 0},
+#endif
+#if defined(WITH_TOM)
+    {"tom", bic_tom::backend_main, 0},
+#endif
+#if defined(WITH_U128)
+    {"boost-u128", bic_u128::backend_main, 128},
+#endif
+#if defined(WITH_U192)
+    {"boost-u192", bic_u192::backend_main, 192},
+#endif
+#if defined(WITH_U256)
+    {"boost-u256", bic_u256::backend_main, 256},
+#endif
+#if defined(WITH_U320)
+    {"boost-u320", bic_u320::backend_main, 320},
+#endif
+#if defined(WITH_U512)
+    {"boost-u512", bic_u512::backend_main, 512},
+#endif
+};
+
+static const char *help_text =
+    "Usage: %s [-b, --backend=<list>] [OPTIONS]\n"
+    "  Run the command-line interface once per backend in the comma-separated\n"
+    "  <list>, or once per available backend if omitted, with the same seed\n"
+    "  and OPTIONS. Unchecked `boost-u*` widths too narrow for the parameters\n"
+    "  are skipped, and `auto` picks the narrowest one that fits. Available\n"
+    "  backends are:\n";
+
+// whether `name` is an element of the comma-separated `list`
+bool listed(const char *list, const char *name) {
+  const size_t length = strlen(name);
+
+  for (const char *s = list; s != NULL; s = strchr(s, ',')) {
+    s += (*s == ',');
+    if (strncmp(s, name, length) == 0 &&
+        (s[length] == ',' || s[length] == '\0')) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+int32_t main(int32_t argc, char **argv) {
+  const size_t num_backends = sizeof(BACKENDS) / sizeof(backend_t);
+  const char *list = NULL;
+
+  // all backends see the same arguments, with `--backend` removed and a
+  // shared seed in front, which an explicit `--randomness` overrides
+  char seed[16];
+  snprintf(seed, sizeof(seed), "%u", (uint32_t)time(NULL));
+
+  char **args = (char **)calloc(argc + 3, sizeof(char *));
+  int32_t length = 0;
+  args[length++] = argv[0];
+  args[length++] = (char *)"-r";
+  args[length++] = seed;
+
+  for (int32_t i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--backend") == 0) {
+      list = (i + 1 < argc) ? argv[++i] : "";
+    } else if (strncmp(argv[i], "--backend=", 10) == 0) {
+      list = argv[i] + 10;
+    } else if (strncmp(argv[i], "-b", 2) == 0) {
+      list = argv[i] + 2;
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      fprintf(stderr, help_text, argv[0]);
+      for (size_t b = 0; b < num_backends; ++b) {
+        fprintf(stderr, "    * `%s`;\n", BACKENDS[b].name);
+      }
+#if defined(WITH_WIDTHS)
+      fprintf(stderr, "    * `auto`;\n");
+#endif
+      free(args);
+      return 1;
+    } else {
+      args[length++] = argv[i];
+    }
+  }
+
+  int32_t status = 0;
+  size_t runs = 0;
+  uint16_t bits = 0;
+
+#if defined(WITH_WIDTHS)
+  // parse the parameters once with arbitrary precision, so that the unchecked
+  // widths only ever run where they cannot overflow
+  optind = 0;
+  bits = bic_arb::backend_bits(length, args);
+  if (bits == 0) {
+    free(args);
+    return 1;
+  }
+
+  if (list != NULL && strcmp(list, "auto") == 0) {
+    list = "boost-arb";
+    for (size_t b = 0; b < num_backends; ++b) {
+      if (BACKENDS[b].width >= bits) {
+        list = BACKENDS[b].name;
+        break;
+      }
+    }
+  }
+#endif
+
+  for (size_t b = 0; b < num_backends && status == 0; ++b) {
+    if (list != NULL && !listed(list, BACKENDS[b].name)) {
+      continue;
+    }
+
+    if (BACKENDS[b].width > 0 && BACKENDS[b].width < bits) {
+      fprintf(stderr, "%s: skipped, %u bits needed\n", BACKENDS[b].name,
+              bits);
+      continue;
+    }
+
+    if (list == NULL || strchr(list, ',') != NULL) {
+      printf("%s\n", BACKENDS[b].name);
+      fflush(stdout);
+    }
+
+    // restart the scan of `getopt_long` for the next backend
+    optind = 0;
+    status = BACKENDS[b].main(length, args);
+    ++runs;
+  }
+
+  if (runs == 0 && fprintf(stderr, "Invalid parameter.\n")) {
+    status = 1;
+  }
+
+  free(args);
+  return status;
+}
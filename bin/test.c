@@ -1,17 +1,59 @@
 #include <assert.h>
 #include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
+#include "batch.h"
 #include "cache.h"
 #include "colex.h"
 #include "common.h"
+#include "digest.h"
 #include "gray.h"
+#include "kernels.h"
 #include "math.h"
+#include "pack.h"
+#include "paramset.h"
 #include "rbo.h"
+#include "tail.h"
 #include "utils.h"
+#include "workspace.h"
+
+#if defined(__cplusplus)
+#define ALLOC_NOEXCEPT noexcept
+extern "C" {
+#else
+#define ALLOC_NOEXCEPT
+#endif
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+#if defined(__cplusplus)
+}
+#endif
+
+// count every heap allocation made by the process, including `operator new`,
+// from any thread
+static size_t allocations = 0;
+
+void *malloc(size_t size) ALLOC_NOEXCEPT {
+  __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) ALLOC_NOEXCEPT {
+  __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+  return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) ALLOC_NOEXCEPT {
+  __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+  return __libc_realloc(ptr, size);
+}
 
 typedef void (*param_gen_func)(uint16_t *, uint16_t *, uint16_t *);
 
@@ -22,7 +64,7 @@ void gen_params_random(uint16_t *n, uint16_t *k, uint16_t *d);
 typedef struct {
   const char *name;
   void (*unrank_func)(uint32_t *, const uint16_t, const uint16_t,
-                      const uint16_t, const uintx);
+                      const uint16_t, uintx_cref, workspace_t *);
 } algo_t;
 
 typedef struct {
@@ -37,16 +79,38 @@ typedef struct {
   int strategy;
 } cache_cfg_t;
 
+typedef struct {
+  const char *name;
+  int layout;
+} layout_cfg_t;
+
 typedef struct {
   const char *name;
   param_gen_func func;
 } strategy_cfg_t;
 
+typedef struct {
+  const char *name;
+  int fill;
+} fill_cfg_t;
+
+// a contiguous range of ranks, verified by one thread with its own buffers
+typedef struct {
+  order ord;
+  uint16_t n;
+  uint16_t k;
+  uint16_t d;
+  uint64_t first;
+  uint64_t last;
+  uint64_t *done;
+} worker_t;
+
 static const algo_t ALGOS_COLEX[] = {{"default", colex_unrank},
                                      {"ps", colex_unrank_part_sums},
                                      {"al", colex_unrank_acc_linear},
                                      {"ab", colex_unrank_acc_bisect},
-                                     {"ad", colex_unrank_acc_direct}};
+                                     {"ad", colex_unrank_acc_direct},
+                                     {"ai", colex_unrank_acc_interp}};
 
 static const order_cfg_t ORDERS[] = {
     {"colex", colex, ALGOS_COLEX, sizeof(ALGOS_COLEX) / sizeof(algo_t)},
@@ -59,6 +123,14 @@ static const cache_cfg_t CACHES[] = {{"none", NO_CACHE},
                                      {"scomb", SMALL_COMB_CACHE},
                                      {"acc", ACC_COMB_CACHE}};
 
+static const layout_cfg_t LAYOUTS[] = {{"row", ROW_MAJOR_LAYOUT},
+                                       {"band", BAND_LAYOUT},
+                                       {"column", COLUMN_MAJOR_LAYOUT},
+                                       {"tiled", TILED_LAYOUT}};
+
+static const fill_cfg_t FILLS[] = {{"eager", EAGER_FILL},
+                                   {"lazy", LAZY_FILL}};
+
 static const strategy_cfg_t STRATEGIES[] = {{"mingen", gen_params_mingen},
                                             {"minver", gen_params_minver},
                                             {"random", gen_params_random}};
@@ -66,6 +138,8 @@ static const strategy_cfg_t STRATEGIES[] = {{"mingen", gen_params_mingen},
 static const struct option long_options[] = {
     {"iterations", required_argument, 0, 'i'},
     {"seed", required_argument, 0, 's'},
+    {"exhaustive", required_argument, 0, 'e'},
+    {"threads", required_argument, 0, 'j'},
     {0, 0, 0, 0}};
 
 static const char *help_text =
@@ -74,7 +148,16 @@ static const char *help_text =
     "         Set the number of random tests per configuration.\n"
     "\n"
     "  -s, --seed=<uint32_t>\n"
-    "         Set the seed for the random number generator.\n";
+    "         Set the seed for the random number generator.\n"
+    "\n"
+    "  -e, --exhaustive=<uint32_t>\n"
+    "         Instead of random tests, unrank and rank back every rank of\n"
+    "         `iterations` random C(n, k, d) with at most this many\n"
+    "         compositions, per configuration.\n"
+    "\n"
+    "  -j, --threads=<uint32_t>\n"
+    "         Set the number of threads for `--exhaustive`, by default one\n"
+    "         per online core.\n";
 
 void gen_params_mingen(uint16_t *n, uint16_t *k, uint16_t *d) {
   do {
@@ -98,38 +181,131 @@ void gen_params_random(uint16_t *n, uint16_t *k, uint16_t *d) {
   *n = (random() % ((*k * *d + 1) / 2)) + 1;
 }
 
+void gen_params_small(uint16_t *n, uint16_t *k, uint16_t *d,
+                      const uint32_t limit) {
+  do {
+    *k = (random() % 12) + 1;
+    *d = (random() % 12) + 1;
+    *n = random() % (*k * *d + 1);
+  } while (inner_bic_with_sums(*n, *k, *d, NULL, pascal) > limit);
+}
+
 void run_round_trip(order ord, const uint16_t n, const uint16_t k,
                     const uint16_t d) {
-  uintx all = inner_bic_with_sums(n, k, d, NULL, inner_bin);
+  uintx all = inner_bic_with_sums(n, k, d, NULL, pascal);
   if (all == 0) {
     return;
   }
 
-  const uintx r = random_rank(n, k, d);
-  uintx rr;
+  workspace_t ws;
+  setup_workspace(&ws, n, k, d);
 
   uint32_t *comp = (uint32_t *)malloc(k * sizeof(uint32_t));
   assert(comp != NULL);
 
-  (*ord.unrank)(comp, n, k, d, r);
-  check_valid_bounded_composition(comp, n, k, d);
-  rr = (*ord.rank)(n, k, d, comp);
+  size_t before = allocations;
+
+  const uintx r = random_rank(n, k, d, &ws);
+#if defined(BOOST_ARB_INT) || defined(BOOST_MPZ_INT)
+  // heap-backed integers reuse the blocks that earlier runs left in the pools,
+  // two of them, as the workspace swaps its own blocks with the temporaries
+  // moved into it
+  for (uint8_t i = 0; i < 2 && alloc_mode == POOL_ALLOC; ++i) {
+    (*ord.unrank)(comp, n, k, d, r, &ws);
+    (void)(*ord.rank)(n, k, d, comp);
+    before = allocations;
+  }
+#endif
+  (*ord.unrank)(comp, n, k, d, r, &ws);
+  uintx rr = (*ord.rank)(n, k, d, comp);
+
+#if defined(BITINT) || defined(BOOST_FIX_INT) || defined(BOOST_UINT_INT)
+  // fixed-width integers never allocate
+  assert(allocations == before);
+#elif defined(BOOST_ARB_INT) || defined(BOOST_MPZ_INT)
+  assert(alloc_mode != POOL_ALLOC || allocations == before);
+#endif
+  (void)before;
 
+  check_valid_bounded_composition(comp, n, k, d);
   assert(r == rr);
 
+  if (ord.rank == colex_rank) {
+    assert(colex_rank_acc(n, k, d, comp) == r);
+  } else if (ord.rank == gray_rank) {
+    assert(gray_rank_acc(n, k, d, comp) == r);
+  }
+
+  order small_d = specialize_order(ord, d);
+  if (small_d.unrank != ord.unrank) {
+    memset(comp, 0, k * sizeof(uint32_t));
+    (*small_d.unrank)(comp, n, k, d, r, &ws);
+    assert((*ord.rank)(n, k, d, comp) == r);
+  }
+
+  uint32_t (*next)(part_iter_t *) = (ord.rank == colex_rank)  ? colex_next
+                                    : (ord.rank == gray_rank) ? gray_next
+                                                              : NULL;
+  if (next != NULL) {
+    part_iter_t it;
+    setup_part_iter(&it, n, k, d, r);
+    for (uint16_t i = k; i > 0; --i) {
+      assert((*next)(&it) == comp[i - 1]);
+    }
+  }
+
+  if (ord.rank == colex_rank) {
+    const uintx deltas[] = {0, 1, (uintx)(random() % 1024),
+                            random_rank(n, k, d, &ws), all};
+    for (size_t i = 0; i < sizeof(deltas) / sizeof(uintx); ++i) {
+      (*ord.unrank)(comp, n, k, d, r, &ws);
+      colex_advance(comp, n, k, d, deltas[i], &ws);
+      check_valid_bounded_composition(comp, n, k, d);
+      assert((*ord.rank)(n, k, d, comp) == (r + deltas[i]) % all);
+    }
+  }
+
+  uint8_t formats[] = {U16_FORMAT, BIT_FORMAT, select_format(d)};
+  for (size_t f = 0; f < sizeof(formats); ++f) {
+    void *packed = calloc(packed_size(k, d, formats[f]), 1);
+    assert(packed != NULL);
+
+    packed_unrank(&ord, packed, n, k, d, r, formats[f], &ws);
+    check_valid_packed_composition(packed, n, k, d, formats[f]);
+    assert(packed_rank(&ord, packed, n, k, d, formats[f], &ws) == r);
+
+    free(packed);
+  }
+
+  // a digest as long as the widest integer allows, reduced by Barrett
+  const size_t length = (BIT_LENGTH < 512) ? BIT_LENGTH / 8 : 64;
+  uint8_t digest[64];
+  for (size_t i = 0; i < length; ++i) {
+    digest[i] = random();
+  }
+  const uintx reduced = import_rank(digest, length) % all;
+  assert(reduce_rank(digest, length, &ws) == reduced);
+  unrank_from_bytes(&ord, comp, n, k, d, digest, length, &ws);
+  check_valid_bounded_composition(comp, n, k, d);
+  rank_to_bytes(&ord, digest, length, n, k, d, comp);
+  assert(import_rank(digest, length) == reduced);
+
   free(comp);
+  free_workspace(&ws);
 }
 
 void report_test(const char *order_name, const char *algo_name,
                  const char *strat_name, uint32_t n, uint32_t k, uint32_t d) {
-  printf("n=%-5u k=%-5u d=%-5u m=%-5d b=%-5.0f c=%-2u o=%-5s a=%-7s s=%-6s\n",
-         n, k, d, bits_fit_bic(n, k, d), BIT_LENGTH, cache_type, order_name,
-         algo_name, strat_name);
+  printf("n=%-5u k=%-5u d=%-5u m=%-5d b=%-5.0f c=%-2u l=%-2u o=%-5s a=%-7s "
+         "s=%-6s\n",
+         n, k, d, bits_fit_bic(n, k, d), BIT_LENGTH, cache_type, cache_layout,
+         order_name, algo_name, strat_name);
 }
 
 void run_suite(uint32_t iterations) {
   const size_t num_orders = sizeof(ORDERS) / sizeof(order_cfg_t);
   const size_t num_caches = sizeof(CACHES) / sizeof(cache_cfg_t);
+  const size_t num_layouts = sizeof(LAYOUTS) / sizeof(layout_cfg_t);
   const size_t num_strats = sizeof(STRATEGIES) / sizeof(strategy_cfg_t);
 
   for (size_t i = 0; i < num_orders; ++i) {
@@ -148,29 +324,322 @@ void run_suite(uint32_t iterations) {
       for (size_t c = 0; c < num_caches; ++c) {
         cache_type = CACHES[c].strategy;
 
-        for (size_t s = 0; s < num_strats; ++s) {
-          strategy_cfg_t strat_cfg = STRATEGIES[s];
+        for (size_t l = 0; l < num_layouts; ++l) {
+          cache_layout = LAYOUTS[l].layout;
+          if (cache_type < COMB_CACHE && cache_layout != ROW_MAJOR_LAYOUT) {
+            continue;
+          }
+
+          for (size_t s = 0; s < num_strats; ++s) {
+            strategy_cfg_t strat_cfg = STRATEGIES[s];
 
-          for (uint32_t t = 0; t < iterations; ++t) {
-            uint16_t n = 0, d = 0, k = 0;
-            strat_cfg.func(&n, &k, &d);
-            report_test(order_cfg.name, algo_name, strat_cfg.name, n, k, d);
-            build_caches(n, k, d);
+            for (uint32_t t = 0; t < iterations; ++t) {
+              uint16_t n = 0, d = 0, k = 0;
+              strat_cfg.func(&n, &k, &d);
+              report_test(order_cfg.name, algo_name, strat_cfg.name, n, k, d);
+              grow_caches(n, k, d);
+              run_round_trip(test_order, n, k, d);
+            }
+          }
+          free_caches();
+        }
+      }
+    }
+  }
+}
+
+// every order and cache with `*flag` set to `value`, reset afterwards
+void run_variant(const char *name, int *flag, int value, uint32_t iterations) {
+  const size_t num_orders = sizeof(ORDERS) / sizeof(order_cfg_t);
+  const size_t num_caches = sizeof(CACHES) / sizeof(cache_cfg_t);
+  const size_t num_layouts = sizeof(LAYOUTS) / sizeof(layout_cfg_t);
+
+  *flag = value;
+  for (size_t c = 1; c < num_caches; ++c) {
+    cache_type = CACHES[c].strategy;
+
+    for (size_t l = 0; l < num_layouts; ++l) {
+      cache_layout = LAYOUTS[l].layout;
+      if (cache_type < COMB_CACHE && cache_layout != ROW_MAJOR_LAYOUT) {
+        continue;
+      }
+
+      for (uint32_t t = 0; t < iterations; ++t) {
+        uint16_t n = 0, d = 0, k = 0;
+        gen_params_mingen(&n, &k, &d);
+        grow_caches(n, k, d);
+
+        for (size_t i = 0; i < num_orders; ++i) {
+          size_t num_algos = (ORDERS[i].algos) ? ORDERS[i].num_algos : 1;
+          for (size_t j = 0; j < num_algos; ++j) {
+            order test_order = ORDERS[i].ord;
+            const char *algo_name = "default";
+            if (ORDERS[i].algos) {
+              test_order.unrank = ORDERS[i].algos[j].unrank_func;
+              algo_name = ORDERS[i].algos[j].name;
+            }
+
+            report_test(ORDERS[i].name, algo_name, name, n, k, d);
             run_round_trip(test_order, n, k, d);
-            free_caches();
           }
         }
       }
+      free_caches();
     }
   }
+  *flag = 0;
+}
+
+// caches grown over parameters sharing `d` must match the ones built for each
+void run_growth(uint32_t iterations) {
+  const size_t num_caches = sizeof(CACHES) / sizeof(cache_cfg_t);
+
+  for (size_t c = 1; c < num_caches; ++c) {
+    cache_type = CACHES[c].strategy;
+    cache_layout = ROW_MAJOR_LAYOUT;
+
+    for (int sums = ROW_SUMS; sums < SUMS_SENTINEL_LENGTH; ++sums) {
+      cache_sums = sums;
+      if (cache_type < ACC_COMB_CACHE && cache_sums != ROW_SUMS) {
+        continue;
+      }
+
+      uint16_t n = 0, d = 0, k = 0;
+      gen_params_random(&n, &k, &d);
+      for (uint32_t t = 0; t < iterations; ++t) {
+        uint16_t grown_k = (random() % 64) + 1;
+        uint16_t grown_n = (random() % ((grown_k * d + 1) / 2)) + 1;
+        report_test("colex", "default", "growth", grown_n, grown_k, d);
+        grow_caches(grown_n, grown_k, d);
+
+        for (uint16_t i = 1; i < grown_k; ++i) {
+          for (uint16_t j = 0; j <= grown_n; ++j) {
+            assert(bic(j, i, d) == inner_bic(j, i, d));
+          }
+        }
+        run_round_trip(ORDERS[0].ord, grown_n, grown_k, d);
+      }
+      free_caches();
+    }
+  }
+  cache_sums = ROW_SUMS;
+}
+
+// BATCH_LANES random ranks in lockstep must match the scalar path lane by lane
+void run_batch(uint32_t iterations) {
+  cache_type = ACC_COMB_CACHE;
+  cache_layout = ROW_MAJOR_LAYOUT;
+
+  for (uint32_t t = 0; t < iterations; ++t) {
+    uint16_t n = 0, d = 0, k = 0;
+    gen_params_mingen(&n, &k, &d);
+    report_test("colex", "batch", "mingen", n, k, d);
+    grow_caches(n, k, d);
+
+    workspace_t ws;
+    setup_workspace(&ws, n, k, d);
+    batch_t b;
+    build_batch(&b, n, k, d);
+
+    uintx ranks[BATCH_LANES];
+    uint64_t *sliced = (uint64_t *)calloc(b.limbs * BATCH_LANES, 8);
+    uint32_t *comb = (uint32_t *)calloc(k * BATCH_LANES, sizeof(uint32_t));
+    uint32_t *comp = (uint32_t *)calloc(k, sizeof(uint32_t));
+    assert(sliced != NULL && comb != NULL && comp != NULL);
+
+    for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+      ranks[l] = random_rank(n, k, d, &ws);
+    }
+    // the first and last ranks, in a lane of their own
+    ranks[0] = 0;
+    ranks[BATCH_LANES - 1] = ws.modulus - 1;
+
+    batch_import(&b, sliced, ranks);
+    batch_unrank(&b, comb, sliced);
+    for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+      colex_unrank_acc_linear(comp, n, k, d, ranks[l], &ws);
+      for (uint16_t i = 0; i < k; ++i) {
+        assert(comb[i * BATCH_LANES + l] == comp[i]);
+      }
+    }
+
+    uintx rr[BATCH_LANES];
+    batch_rank(&b, sliced, comb);
+    batch_export(&b, rr, sliced);
+    for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+      assert(rr[l] == ranks[l]);
+    }
+
+    free(comp);
+    free(comb);
+    free(sliced);
+    free_batch(&b);
+    free_workspace(&ws);
+    free_caches();
+  }
+}
+
+void run_paramsets(void) {
+  const size_t num_orders = sizeof(ORDERS) / sizeof(order_cfg_t);
+  const size_t num_caches = sizeof(CACHES) / sizeof(cache_cfg_t);
+
+  for (const paramset_t *set = PARAMSETS; set->name != NULL; ++set) {
+    for (size_t c = 1; c < num_caches; ++c) {
+      cache_type = CACHES[c].strategy;
+      cache_layout = ROW_MAJOR_LAYOUT;
+      load_caches(set);
+
+      for (size_t i = 0; i < num_orders; ++i) {
+        report_test(ORDERS[i].name, "default", set->name, set->n, set->k,
+                    set->d);
+        run_round_trip(ORDERS[i].ord, set->n, set->k, set->d);
+      }
+
+      free_caches();
+    }
+  }
+}
+
+void *verify_ranks(void *arg) {
+  worker_t *w = (worker_t *)arg;
+
+  workspace_t ws;
+  setup_workspace(&ws, w->n, w->k, w->d);
+  uint32_t *comp = (uint32_t *)calloc(w->k, sizeof(uint32_t));
+  assert(comp != NULL);
+
+  // ranks map to valid compositions and back, so unranking is injective on a
+  // range as large as C(n, k, d) and thus a bijection
+  const uint64_t step = 1024;
+  for (uint64_t r = w->first; r < w->last; ++r) {
+    (*w->ord.unrank)(comp, w->n, w->k, w->d, (uintx)r, &ws);
+    check_valid_bounded_composition(comp, w->n, w->k, w->d);
+    assert((*w->ord.rank)(w->n, w->k, w->d, comp) == (uintx)r);
+
+    if ((r - w->first + 1) % step == 0) {
+      __atomic_fetch_add(w->done, step, __ATOMIC_RELAXED);
+    }
+  }
+  __atomic_fetch_add(w->done, (w->last - w->first) % step, __ATOMIC_RELAXED);
+
+  free(comp);
+  free_workspace(&ws);
+  return NULL;
+}
+
+uint64_t verify_bijection(order ord, const uint16_t n, const uint16_t k,
+                          const uint16_t d, const uint32_t threads) {
+  const uint64_t total = (uint64_t)inner_bic_with_sums(n, k, d, NULL, pascal);
+  uint64_t done = 0;
+
+  pthread_t *ids = (pthread_t *)calloc(threads, sizeof(pthread_t));
+  worker_t *workers = (worker_t *)calloc(threads, sizeof(worker_t));
+  assert(ids != NULL && workers != NULL);
+
+  for (uint32_t t = 0; t < threads; ++t) {
+    workers[t].ord = ord;
+    workers[t].n = n;
+    workers[t].k = k;
+    workers[t].d = d;
+    workers[t].first = total * t / threads;
+    workers[t].last = total * (t + 1) / threads;
+    workers[t].done = &done;
+    int err = pthread_create(&ids[t], NULL, verify_ranks, &workers[t]);
+    assert(err == 0);
+    (void)err;
+  }
+
+  // poll often so that small sets do not wait, but only report every 100 ms
+  const struct timespec interval = {0, 1000000};
+  for (uint32_t polls = 0; __atomic_load_n(&done, __ATOMIC_RELAXED) < total;
+       ++polls) {
+    if (polls % 100 == 99) {
+      fprintf(stderr, "\r%20" PRIu64 " / %-20" PRIu64,
+              __atomic_load_n(&done, __ATOMIC_RELAXED), total);
+    }
+    nanosleep(&interval, NULL);
+  }
+  fprintf(stderr, "\r%43s\r", "");
+
+  for (uint32_t t = 0; t < threads; ++t) {
+    pthread_join(ids[t], NULL);
+  }
+
+  free(workers);
+  free(ids);
+  return total;
+}
+
+void run_exhaustive(uint32_t iterations, const uint32_t limit,
+                    const uint32_t threads) {
+  const size_t num_orders = sizeof(ORDERS) / sizeof(order_cfg_t);
+  const size_t num_caches = sizeof(CACHES) / sizeof(cache_cfg_t);
+  const size_t num_layouts = sizeof(LAYOUTS) / sizeof(layout_cfg_t);
+  const size_t num_fills = sizeof(FILLS) / sizeof(fill_cfg_t);
+
+  uint64_t ranks = 0;
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+
+  for (uint32_t t = 0; t < iterations; ++t) {
+    uint16_t n = 0, d = 0, k = 0;
+    gen_params_small(&n, &k, &d, limit);
+
+    for (size_t c = 0; c < num_caches; ++c) {
+      cache_type = CACHES[c].strategy;
+
+      for (size_t l = 0; l < num_layouts; ++l) {
+        cache_layout = LAYOUTS[l].layout;
+        if (cache_type < COMB_CACHE && cache_layout != ROW_MAJOR_LAYOUT) {
+          continue;
+        }
+
+        for (size_t f = 0; f < num_fills; ++f) {
+          cache_fill = FILLS[f].fill;
+          if (cache_type < COMB_CACHE && cache_fill != EAGER_FILL) {
+            continue;
+          }
+          build_caches(n, k, d);
+
+          for (size_t i = 0; i < num_orders; ++i) {
+            order_cfg_t order_cfg = ORDERS[i];
+            size_t num_algos = (order_cfg.algos) ? order_cfg.num_algos : 1;
+
+            for (size_t j = 0; j < num_algos; ++j) {
+              order test_order = order_cfg.ord;
+              const char *algo_name = "default";
+              if (order_cfg.algos) {
+                test_order.unrank = order_cfg.algos[j].unrank_func;
+                algo_name = order_cfg.algos[j].name;
+              }
+
+              report_test(order_cfg.name, algo_name, FILLS[f].name, n, k, d);
+              ranks += verify_bijection(test_order, n, k, d, threads);
+            }
+          }
+
+          free_caches();
+        }
+      }
+    }
+  }
+  cache_fill = EAGER_FILL;
+
+  clock_gettime(CLOCK_MONOTONIC_RAW, &stop);
+  long double seconds = (long double)(stop.tv_sec - start.tv_sec) +
+                        (long double)(stop.tv_nsec - start.tv_nsec) / NS_TO_SEC;
+  printf("verified %" PRIu64 " ranks in %.2Lf s on %u threads, %.0Lf ranks/s\n",
+         ranks, seconds, threads, ranks / seconds);
 }
 
 int32_t main(int32_t argc, char **argv) {
   uint32_t iterations = 8;
   uint32_t seed = (uint32_t)time(NULL);
+  uint32_t limit = 0;
+  uint32_t threads = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
 
   for (;;) {
-    int c = getopt_long(argc, argv, "i:s:", long_options, NULL);
+    int c = getopt_long(argc, argv, "i:s:e:j:", long_options, NULL);
     if (c == -1) {
       break;
     }
@@ -182,6 +651,12 @@ int32_t main(int32_t argc, char **argv) {
     case 's':
       seed = strtoul(optarg, NULL, 10);
       break;
+    case 'e':
+      limit = strtoul(optarg, NULL, 10);
+      break;
+    case 'j':
+      threads = max(strtoul(optarg, NULL, 10), 1);
+      break;
     default:
       fprintf(stderr, help_text, argv[0]);
       return 1;
@@ -189,7 +664,22 @@ int32_t main(int32_t argc, char **argv) {
   }
 
   srandom(seed);
+  if (limit > 0) {
+    run_exhaustive(iterations, limit, threads);
+    return 0;
+  }
+
   run_suite(iterations);
+  run_variant("huge", &cache_pages, HUGE_PAGES, iterations);
+  run_variant("lazy", &cache_fill, LAZY_FILL, iterations);
+  run_variant("prefix", &cache_sums, PREFIX_SUMS, iterations);
+  run_variant("tail", &tail_budget, 64, iterations);
+#if defined(BOOST_ARB_INT) || defined(BOOST_MPZ_INT)
+  run_variant("system", &alloc_mode, SYSTEM_ALLOC, iterations);
+#endif
+  run_growth(iterations);
+  run_batch(iterations);
+  run_paramsets();
 
   return 0;
 }
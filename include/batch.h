@@ -0,0 +1,43 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "common.h"
+
+// independent ranks (un)ranked in lockstep, one per 64-bit lane of a 512-bit
+// vector, or of two 256-bit ones
+#define BATCH_LANES 8
+
+// the rows of `acc` for every (it_n, i) up to (n, k), limb-sliced so that a
+// lane gathers limb `j` of entry `p` of its own row at
+// (it_n * k + i) * (d + 1) * limbs + j * (d + 1) + p, next to the same limb
+// of the entries around it
+typedef struct {
+  uint64_t *sums;
+  // limbs of the largest entry for each `i`, above which ranks are zero too
+  uint16_t *level_limbs;
+  uint16_t n;
+  uint16_t k;
+  uint16_t d;
+  uint16_t limbs;
+  size_t total_size;
+} batch_t;
+
+// from the caches in place, if any
+void build_batch(batch_t *b, const uint16_t n, const uint16_t k,
+                 const uint16_t d);
+
+void free_batch(batch_t *b);
+
+// in structure-of-arrays form, `ranks[j * BATCH_LANES + l]` is limb `j` of the
+// rank of lane `l`, and `comb[i * BATCH_LANES + l]` is its part `i`
+void batch_import(const batch_t *b, uint64_t *rop, const uintx *ranks);
+
+void batch_export(const batch_t *b, uintx *rop, const uint64_t *ranks);
+
+// `colex_unrank_acc_linear` for BATCH_LANES ranks, which are consumed
+void batch_unrank(const batch_t *b, uint32_t *rop, uint64_t *ranks);
+
+// `colex_rank` for BATCH_LANES compositions
+void batch_rank(const batch_t *b, uint64_t *rop, const uint32_t *comb);
+
+#endif
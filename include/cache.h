@@ -5,10 +5,14 @@
 #include <stdlib.h>
 
 #include "common.h"
+#include "pool.h"
 
 #define GET_CACHE_BIN(row, col)                                                \
   (*(uintx *)cache_get_element(&bin_cache_t, row, col))
 
+#define GET_CACHE_PASCAL(row, col)                                             \
+  (*(uintx *)cache_get_element(&pascal_cache_t, row, col))
+
 #define GET_CACHE_COMB(row, col)                                               \
   (*(uintx *)cache_get_element(&comb_cache_t, row, col))
 
@@ -18,11 +22,8 @@
 #define GET_CACHE_ACC(row, col)                                                \
   (*(uintx **)cache_get_element(&acc_cache_t, row, col))
 
-#define GET_CACHE_OR_CALC(type, logic, math)                                   \
-  if (cache_type >= type) {                                                    \
-    return logic;                                                              \
-  }                                                                            \
-  return math(n, k, d);
+#define GET_CACHE_PREFIX(row, col)                                             \
+  (*(uintx *)cache_get_element(&acc_cache_t, row, col))
 
 enum {
   NO_CACHE = 0,
@@ -33,27 +34,171 @@ enum {
   SENTINEL_LENGTH = 5,
 };
 
+enum {
+  ROW_MAJOR_LAYOUT = 0,
+  BAND_LAYOUT = 1,
+  COLUMN_MAJOR_LAYOUT = 2,
+  TILED_LAYOUT = 3,
+  LAYOUT_SENTINEL_LENGTH = 4,
+};
+
+// side of the square tiles of TILED_LAYOUT, 4 KiB of 512-bit integers
+static const uint32_t TILE_SIDE = 8;
+
+enum {
+  BASE_PAGES = 0,
+  HUGE_PAGES = 1,
+  PAGES_SENTINEL_LENGTH = 2,
+};
+
+enum {
+  EAGER_FILL = 0,
+  LAZY_FILL = 1,
+  FILL_SENTINEL_LENGTH = 2,
+};
+
+// how the acc cache holds its sums: a row of d + 3 for each (n, k), or only
+// the prefix sums P(n, k) of each column of #C(n, k, d), of which every entry
+// is the difference acc(n, k)[l] = P(n, k) - P(n - l, k)
+enum {
+  ROW_SUMS = 0,
+  PREFIX_SUMS = 1,
+  SUMS_SENTINEL_LENGTH = 2,
+};
+
+// per-cell state of a lazily filled cache, only ever moving forward
+enum {
+  CELL_EMPTY = 0,
+  CELL_BUSY = 1,
+  CELL_READY = 2,
+};
+
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
 extern int cache_type;
+extern int cache_layout;
+extern int cache_pages;
+extern int cache_fill;
+extern int cache_sums;
 
+// rows [lo, hi] of a column folded by C(n, k, d) = C(k * d - n, k, d)
 typedef struct {
+  uint32_t lo;
+  uint32_t hi;
+  uint32_t top;
+  uint32_t offset;
+} band_t;
+
+typedef struct cache_t cache_t;
+
+typedef uint32_t (*index_funcptr_t)(const cache_t *, const uint32_t,
+                                    const uint32_t);
+
+struct cache_t {
   void *data;
   uint32_t rows;
   uint32_t cols;
+  uint32_t stride;
   size_t elem_size;
   char *name;
   uint8_t type;
   size_t total_size;
-} cache_t;
+  index_funcptr_t index;
+  band_t *band;
+  bool is_static;
+  size_t page_size;
+  size_t mapped_size;
+  uint8_t *state;
+  size_t cells;
+  size_t filled;
+  size_t row_length;
+  uint8_t layout;
+  // the limbs of heap-backed integers in the cells, released with the cache
+  region_t region;
+  uint16_t n;
+  uint16_t k;
+  uint16_t d;
+};
 
 extern cache_t bin_cache_t;
 extern cache_t comb_cache_t;
 extern cache_t scomb_cache_t;
 extern cache_t acc_cache_t;
 
+// binomial coefficients shared by the whole process, independent of `d` and
+// `cache_type`; `bin_cache_t` is only a view of it
+extern cache_t pascal_cache_t;
+
+// extend the Pascal triangle to at least `rows` by `cols`; the tables it
+// replaces stay readable until exit, so that views taken of them never dangle
+void pascal_grow_cache(const uint32_t rows, const uint32_t cols);
+
 void generic_setup_cache(cache_t *cache, const uint32_t rows,
                          const uint32_t cols, const size_t elem_size,
                          char *name, uint8_t type);
 
+// one block holding the row pointers and then each row of `length` elements
+void arena_setup_cache(cache_t *cache, const uint32_t rows, const uint32_t cols,
+                       const size_t length, char *name, uint8_t type);
+
+// a full table stored as `layout` asks for, which may not be BAND_LAYOUT
+void layout_setup_cache(cache_t *cache, const uint32_t rows,
+                        const uint32_t cols, const size_t elem_size,
+                        char *name, uint8_t type, uint8_t layout);
+
+void band_setup_cache(cache_t *cache, const uint16_t n, const uint16_t k,
+                      const uint16_t d, char *name, uint8_t type);
+
+void static_setup_cache(cache_t *cache, const void *data, const uint32_t rows,
+                        const uint32_t cols, const size_t elem_size,
+                        char *name, uint8_t type);
+
+void generic_free_cache(cache_t *cache);
+
+// zeroed storage for `cache->data`, in huge pages if `cache_pages` asks for it
+void cache_alloc(cache_t *cache, const size_t nmemb, const size_t size);
+
+void cache_dealloc(cache_t *cache);
+
+// leave the cells of `cache` to be computed on first access
+void lazy_setup_cache(cache_t *cache);
+
+// #C(n, k, d) and its accumulated sums from lazily filled caches; a cell that
+// another thread is filling is computed into `buffer` instead of waiting for it
+const uintx *lazy_comb(const uint16_t n, const uint16_t k, const uint16_t d,
+                       uintx *buffer);
+
+uintx *lazy_acc(const uint16_t n, const uint16_t k, const uint16_t d,
+                uintx *buffer);
+
+// entry `l` of acc(n, k, d) and the whole row in `buffer`, from the prefix
+// sums, which are always filled eagerly
+uintx prefix_bic_acc(const uint16_t n, const uint16_t k, const uint16_t l);
+
+uintx *prefix_acc(const uint16_t n, const uint16_t k, const uint16_t d,
+                  uintx *buffer);
+
+// smallest page size backing the caches built, zero if there are none
+size_t caches_page_size(void);
+
+uint32_t row_major_index(const cache_t *cache, const uint32_t row,
+                         const uint32_t col);
+
+uint32_t band_index(const cache_t *cache, const uint32_t row,
+                    const uint32_t col);
+
+uint32_t column_major_index(const cache_t *cache, const uint32_t row,
+                            const uint32_t col);
+
+uint32_t tiled_index(const cache_t *cache, const uint32_t row,
+                     const uint32_t col);
+
+uint32_t column_index(const cache_t *cache, const uint32_t row,
+                      const uint32_t col);
+
+bool cache_contains(const cache_t *cache, const uint32_t row,
+                    const uint32_t col);
+
 void *cache_get_element(const cache_t *cache, const uint32_t row,
                         const uint32_t col);
 
@@ -71,6 +216,19 @@ static const build_cache_funcptr_t cache_builders[SENTINEL_LENGTH] = {
     scomb_build_cache, acc_build_cache,
 };
 
+// keep the cells built for a smaller (n, k) and the same `d`, computing only
+// the rows and columns missing for (n, k, d), or rebuild if they cannot be kept
+void grow_caches(const uint16_t n, const uint16_t k, const uint16_t d);
+void bin_grow_cache(const uint16_t n, const uint16_t k, const uint16_t d);
+void comb_grow_cache(const uint16_t n, const uint16_t k, const uint16_t d);
+void scomb_grow_cache(const uint16_t n, const uint16_t k, const uint16_t d);
+void acc_grow_cache(const uint16_t n, const uint16_t k, const uint16_t d);
+
+static const build_cache_funcptr_t cache_growers[SENTINEL_LENGTH] = {
+    grow_caches,      bin_grow_cache, comb_grow_cache,
+    scomb_grow_cache, acc_grow_cache,
+};
+
 typedef void (*free_cache_funcptr_t)(void);
 
 void free_caches();
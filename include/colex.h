@@ -2,26 +2,53 @@
 #define COLEX_H
 
 #include "common.h"
+#include "kernels.h"
 
 void colex_unrank(uint32_t *rop, const uint16_t n, const uint16_t k,
-                  const uint16_t d, const uintx r);
+                  const uint16_t d, uintx_cref r, workspace_t *ws);
 
 void colex_unrank_part_sums(uint32_t *rop, const uint16_t n, const uint16_t k,
-                            const uint16_t d, uintx r);
+                            const uint16_t d, uintx_cref r, workspace_t *ws);
 
 void colex_unrank_acc_linear(uint32_t *rop, const uint16_t n, const uint16_t k,
-                             const uint16_t d, const uintx r);
+                             const uint16_t d, uintx_cref r, workspace_t *ws);
 
 void colex_unrank_acc_bisect(uint32_t *rop, const uint16_t n, const uint16_t k,
-                             const uint16_t d, const uintx r);
+                             const uint16_t d, uintx_cref r, workspace_t *ws);
+
+// guess the part by interpolating the leading bits of the accumulated sums,
+// then correct it with exact comparisons
+void colex_unrank_acc_interp(uint32_t *rop, const uint16_t n, const uint16_t k,
+                             const uint16_t d, uintx_cref r, workspace_t *ws);
 
 // algorithm 3 of 10.1007/s13389-021-00264-9
 void colex_unrank_acc_direct(uint32_t *rop, const uint16_t n, const uint16_t k,
-                             const uint16_t d, const uintx r);
+                             const uint16_t d, uintx_cref r, workspace_t *ws);
+
+// `colex_unrank`, `colex_unrank_part_sums` and `colex_unrank_acc_linear` for
+// each constant bound up to SMALL_D_MAX
+extern const unrank_func colex_unrank_small_d[SMALL_D_MAX + 1];
+
+extern const unrank_func colex_unrank_part_sums_small_d[SMALL_D_MAX + 1];
+
+extern const unrank_func colex_unrank_acc_linear_small_d[SMALL_D_MAX + 1];
 
 uintx colex_rank(const uint16_t n, const uint16_t k, const uint16_t d,
                  const uint32_t *comb);
 
+// `colex_rank` with the terms of each part summed at once by `bic_acc`, a
+// lookup in the acc cache or proposition 3 of 10.1007/s13389-021-00264-9
+uintx colex_rank_acc(const uint16_t n, const uint16_t k, const uint16_t d,
+                     const uint32_t *comb);
+
+// next part of `colex_unrank`, see `part_iter_t`
+uint32_t colex_next(part_iter_t *it);
+
+// set `comb` to the composition `delta` ranks after it, modulo |C(n, k, d)|,
+// unranking again only the low-order parts that change
+void colex_advance(uint32_t *comb, const uint16_t n, const uint16_t k,
+                   const uint16_t d, uintx_cref delta, workspace_t *ws);
+
 static const order colex = {.unrank = colex_unrank, .rank = colex_rank};
 
 #endif
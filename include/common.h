@@ -13,38 +13,103 @@ static const uint32_t NS_TO_SEC = 1000000000;
 
 using uintx = boost::multiprecision::checked_uint512_t;
 using intx = boost::multiprecision::checked_int512_t;
+static const char BACKEND_NAME[] = "boost-fix";
 static const double BIT_LENGTH = 512;
+#elif defined(BOOST_UINT_INT)
+#include <boost/multiprecision/cpp_int.hpp>
+
+// unchecked, so only for parameters whose terms are known to fit, see
+// `bits_fit_terms`
+using uintx = boost::multiprecision::number<
+    boost::multiprecision::cpp_int_backend<
+        BOOST_UINT_INT, BOOST_UINT_INT,
+        boost::multiprecision::unsigned_magnitude,
+        boost::multiprecision::unchecked, void>>;
+using intx = boost::multiprecision::number<
+    boost::multiprecision::cpp_int_backend<
+        BOOST_UINT_INT, BOOST_UINT_INT,
+        boost::multiprecision::signed_magnitude,
+        boost::multiprecision::unchecked, void>>;
+#define STRINGIFY(x) #x
+#define EXPAND_STRINGIFY(x) STRINGIFY(x)
+static const char BACKEND_NAME[] = "boost-u" EXPAND_STRINGIFY(BOOST_UINT_INT);
+static const double BIT_LENGTH = BOOST_UINT_INT;
 #elif defined(BOOST_ARB_INT)
 #include <boost/multiprecision/cpp_int.hpp>
 
-using uintx = boost::multiprecision::cpp_int;
-using intx = boost::multiprecision::cpp_int;
+#include "pool.h"
+
+// cpp_int, with limbs from the pools of pool.h instead of `new`
+using uintx = boost::multiprecision::number<
+    boost::multiprecision::cpp_int_backend<
+        0, 0, boost::multiprecision::signed_magnitude,
+        boost::multiprecision::unchecked,
+        pool_allocator<boost::multiprecision::limb_type>>>;
+using intx = uintx;
+static const char BACKEND_NAME[] = "boost-arb";
 static const double BIT_LENGTH = INFINITY;
 #elif defined(BOOST_MPZ_INT)
 #include <boost/multiprecision/gmp.hpp>
 
 using uintx = boost::multiprecision::mpz_int;
 using intx = boost::multiprecision::mpz_int;
+static const char BACKEND_NAME[] = "mpz";
 static const double BIT_LENGTH = INFINITY;
 #elif defined(BOOST_TOM_INT)
 #include <boost/multiprecision/tommath.hpp>
 
 using uintx = boost::multiprecision::tom_int;
 using intx = boost::multiprecision::tom_int;
+static const char BACKEND_NAME[] = "tom";
 static const double BIT_LENGTH = INFINITY;
 #endif
 
 #if defined(BITINT)
 typedef unsigned _BitInt(BITINT) uintx;
 typedef _BitInt(BITINT) intx;
+static const char BACKEND_NAME[] = "bitint";
 static const double BIT_LENGTH = BITINT;
 #else
 #include <boost/multiprecision/cpp_bin_float.hpp>
 #endif
 
+// scratch buffers for one (n, k, d), so that (un)ranking never allocates
+typedef struct {
+  intx *partial_sums;
+  uintx *sums;
+  uint8_t *bytes;
+  uint16_t bytes_length;
+  uint32_t *parts;
+  // #C(n, k, d) and its Barrett reciprocal for digests of `reciprocal_length`
+  // bytes, see reduce_rank
+  uintx modulus;
+  uintx reciprocal;
+  uint16_t modulus_bits;
+  size_t reciprocal_length;
+  size_t total_size;
+} workspace_t;
+
+// state of an unranking that yields one part at a time, from `rop[k - 1]` down
+// to `rop[0]`, so that reading the first `j` parts costs only `j` levels
+typedef struct {
+  uintx rank;
+  uint16_t it_n;
+  uint16_t d;
+  uint16_t remaining;
+} part_iter_t;
+
+// heap-backed and wide integers are taken by reference in C++, never copied
+#if defined(__cplusplus)
+typedef const uintx &uintx_cref;
+#else
+typedef const uintx uintx_cref;
+#endif
+
+typedef void (*unrank_func)(uint32_t *, const uint16_t, const uint16_t,
+                            const uint16_t, uintx_cref, workspace_t *);
+
 typedef struct {
-  void (*unrank)(uint32_t *, const uint16_t, const uint16_t, const uint16_t,
-                 const uintx);
+  unrank_func unrank;
   uintx (*rank)(const uint16_t, const uint16_t, const uint16_t,
                 const uint32_t *);
 } order;
@@ -52,6 +117,9 @@ typedef struct {
 typedef void (*strategy_func)(const uint16_t, uint16_t *, const uint16_t,
                               uint16_t *);
 
-typedef uintx (*math_func)(const uint16_t, const uint16_t, const uint16_t);
+// a binomial read in place where a cache holds it, or else computed into the
+// buffer given, so that cached ones are never copied
+typedef const uintx *(*math_func)(const uint16_t, const uint16_t,
+                                  const uint16_t, uintx *);
 
 #endif
@@ -0,0 +1,31 @@
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include "common.h"
+
+// the big-endian integer in `length` bytes, which must fit an `uintx`
+uintx import_rank(const uint8_t *bytes, const size_t length);
+
+// `r` as a big-endian integer in `length` bytes, zero-padded on the left
+void export_rank(uint8_t *rop, const size_t length, uintx_cref r);
+
+// the modulus #C(n, k, d) of the workspace and its bit length
+void setup_modulus(workspace_t *ws, const uint16_t n, const uint16_t k,
+                   const uint16_t d);
+
+// `bytes` modulo #C(n, k, d) by Barrett reduction, whose reciprocal is kept in
+// the workspace for the last `length` seen
+uintx reduce_rank(const uint8_t *bytes, const size_t length, workspace_t *ws);
+
+// unrank a digest, such as a hash, to a composition
+void unrank_from_bytes(const order *ord, uint32_t *rop, const uint16_t n,
+                       const uint16_t k, const uint16_t d,
+                       const uint8_t *digest, const size_t length,
+                       workspace_t *ws);
+
+// rank a composition to `length` big-endian bytes
+void rank_to_bytes(const order *ord, uint8_t *rop, const size_t length,
+                   const uint16_t n, const uint16_t k, const uint16_t d,
+                   const uint32_t *comb);
+
+#endif
@@ -2,13 +2,25 @@
 #define GRAY_H
 
 #include "common.h"
+#include "kernels.h"
 
 void gray_unrank(uint32_t *rop, const uint16_t n, const uint16_t k,
-                 const uint16_t d, const uintx r);
+                 const uint16_t d, uintx_cref r, workspace_t *ws);
+
+// `gray_unrank` for each constant bound up to SMALL_D_MAX
+extern const unrank_func gray_unrank_small_d[SMALL_D_MAX + 1];
+
+// next part of `gray_unrank`, see `part_iter_t`
+uint32_t gray_next(part_iter_t *it);
 
 uintx gray_rank(const uint16_t n, const uint16_t k, const uint16_t d,
                 const uint32_t *comb);
 
+// `gray_rank` with the terms of each part summed at once by `bic_acc`, as a
+// prefix of the row or the difference of two in the reflected case
+uintx gray_rank_acc(const uint16_t n, const uint16_t k, const uint16_t d,
+                    const uint32_t *comb);
+
 static const order gray = {.unrank = gray_unrank, .rank = gray_rank};
 
 #endif
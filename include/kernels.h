@@ -0,0 +1,42 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "common.h"
+
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+// largest bound with an unrolled kernel, covers `mingen` for m <= 256
+#define SMALL_D_MAX 16
+
+#define FOR_EACH_SMALL_D(X, arg)                                               \
+  X(arg, 1) X(arg, 2) X(arg, 3) X(arg, 4) X(arg, 5) X(arg, 6) X(arg, 7)        \
+      X(arg, 8) X(arg, 9) X(arg, 10) X(arg, 11) X(arg, 12) X(arg, 13)          \
+          X(arg, 14) X(arg, 15) X(arg, 16)
+
+#define SMALL_D_KERNEL(kernel, D)                                              \
+  static void kernel##_d##D(uint32_t *rop, const uint16_t n, const uint16_t k, \
+                            const uint16_t d, uintx_cref r, workspace_t *ws) { \
+    (void)d;                                                                   \
+    kernel(rop, n, k, D, r, ws);                                               \
+  }
+
+#define SMALL_D_ENTRY(kernel, D) kernel##_d##D,
+
+// instantiate `kernel` with a constant bound for each small `d`, indexed by it
+#define DEFINE_SMALL_D_KERNELS(table, kernel)                                  \
+  FOR_EACH_SMALL_D(SMALL_D_KERNEL, kernel)                                     \
+  const unrank_func table[SMALL_D_MAX + 1] = {                                 \
+      NULL, FOR_EACH_SMALL_D(SMALL_D_ENTRY, kernel)};
+
+enum {
+  GENERIC_KERNELS = 0,
+  SMALL_D_KERNELS = 1,
+  KERNELS_SENTINEL_LENGTH = 2,
+};
+
+extern int kernel_mode;
+
+// swap the generic unranking of `ord` for its specialization on `d`, if any
+order specialize_order(order ord, const uint16_t d);
+
+#endif
@@ -2,34 +2,129 @@
 #define MATH_H
 
 #include "common.h"
+#include "kernels.h"
+#include "utils.h"
 
-long double lg(const uintx u);
+#if defined(BOOST_TOM_INT)
+static const uint64_t WORD_MAX = MP_MASK;
+#else
+static const uint64_t WORD_MAX = UINT64_MAX;
+#endif
+
+// in-place product and exact quotient by a single machine word
+void mul_word(uintx *rop, const uint64_t w);
+
+void divexact_word(uintx *rop, const uint64_t w);
+
+void smul_word(intx *rop, const uint64_t w);
+
+void sdivexact_word(intx *rop, const uint64_t w);
+
+void smul_bin(intx *rop, uintx_cref b);
+
+long double lg(uintx_cref u);
+
+// number of significant bits of `u`, zero for zero
+uint16_t bit_length(uintx_cref u);
 
 uint16_t bits_fit_bic(const uint16_t n, const uint16_t k, const uint16_t d);
 
+// bits for the widest intermediate of (un)ranking C(n, k, d) with any cache:
+// the largest term of inclusion-exclusion, its sign and its build-up by words
+uint16_t bits_fit_terms(const uint16_t n, const uint16_t k, const uint16_t d);
+
 double asqrt(double x);
 
 // §6.1 of 10.1007/978-3-642-14764-7_6
 uintx inner_bin(const uint16_t n, const uint16_t k, const uint16_t d);
 
-uintx bin(const uint16_t n, const uint16_t k, const uint16_t d);
+const uintx *bin(const uint16_t n, const uint16_t k, const uint16_t d,
+                 uintx *buffer);
+
+// from the process-wide Pascal triangle, grown on demand
+const uintx *pascal(const uint16_t n, const uint16_t k, const uint16_t d,
+                    uintx *buffer);
 
 // remark 60 of 10.24033/asens.136
 uintx inner_bic_with_sums(const uint16_t n, const uint16_t k, const uint16_t d,
                           intx *partial_sums, math_func bin_impl);
 
+// body of inner_bic_with_sums, inlined so that `d + 1` may be a constant
+ALWAYS_INLINE uintx bic_with_sums_kernel(const uint16_t n, const uint16_t k,
+                                         const uint16_t d, intx *partial_sums,
+                                         math_func bin_impl) {
+  if (n == 0) {
+    return 1;
+  }
+
+  intx rop = 0;
+  intx inner = 0;
+  uintx left = 0;
+  uintx right = 0;
+
+  uint16_t j = min(k, n / (d + 1));
+  for (uint16_t i = 0; i <= j; ++i) {
+    const uintx *b = bin_impl(k, i, d, &left);
+    inner = (intx)*bin_impl(n - (d + 1) * i + k - 1, k - 1, d, &right);
+    smul_bin(&inner, *b);
+    if (i & 1U) {
+      inner = -inner;
+    }
+    rop += inner;
+
+    if (partial_sums != NULL) {
+      partial_sums[i] = inner;
+    }
+  }
+
+  return (uintx)rop;
+}
+
 uintx inner_bic(const uint16_t n, const uint16_t k, const uint16_t d);
 
 uintx bic(const uint16_t n, const uint16_t k, const uint16_t d);
 
-uintx *inner_acc(const uint16_t n, const uint16_t k, const uint16_t d);
+// `bic` in place, from its cache if any, or else computed into `buffer`; the
+// view lasts until the caches are freed or `buffer` is written to again
+const uintx *bic_view(const uint16_t n, const uint16_t k, const uint16_t d,
+                      uintx *buffer);
+
+// start loading the cells bic(n - p, k, d) that a level scans, for p up to
+// min(n, d), from the comb cache if `bic` reads from it
+void prefetch_bic(const uint16_t n, const uint16_t k, const uint16_t d);
 
-uintx *acc(const uint16_t n, const uint16_t k, const uint16_t d);
+uintx *inner_acc(uintx *rop, const uint16_t n, const uint16_t k,
+                 const uint16_t d);
+
+// body of inner_acc, inlined so that rows have a constant length
+ALWAYS_INLINE uintx *acc_kernel(uintx *rop, const uint16_t n, const uint16_t k,
+                                const uint16_t d) {
+  size_t length = d + 3;
+  size_t i = 0;
+  uintx sum = 0;
+
+  rop[0] = 0;
+  for (; i <= min(n, d); ++i) {
+    // the entry about to hold the sum is the buffer of the view
+    sum += *bic_view(n - i, k, d, &rop[i + 1]);
+    rop[i + 1] = sum;
+  }
+  rop[length - 1] = i;
+
+  return rop;
+}
+
+uintx *acc(const uint16_t n, const uint16_t k, const uint16_t d,
+           uintx *buffer);
 
 // proposition 3 of 10.1007/s13389-021-00264-9
 uintx bic_acc(const uint16_t n, const uint16_t k, const uint16_t d,
               const uint16_t l);
 
-uintx random_rank(const uint16_t n, const uint16_t k, const uint16_t d);
+const uintx *bic_acc_view(const uint16_t n, const uint16_t k, const uint16_t d,
+                          const uint16_t l, uintx *buffer);
+
+uintx random_rank(const uint16_t n, const uint16_t k, const uint16_t d,
+                  workspace_t *ws);
 
 #endif
@@ -0,0 +1,44 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include "common.h"
+
+enum {
+  U32_FORMAT = 0,
+  U16_FORMAT = 1,
+  U8_FORMAT = 2,
+  BIT_FORMAT = 3,
+  // resolved to the narrowest byte-aligned format by select_format
+  AUTO_FORMAT = 4,
+};
+
+uint8_t select_format(const uint16_t d);
+
+uint8_t part_bits(const uint16_t d, const uint8_t format);
+
+size_t packed_size(const uint16_t k, const uint16_t d, const uint8_t format);
+
+uint32_t get_part(const void *comb, const uint16_t i, const uint8_t bits);
+
+void set_part(void *comb, const uint16_t i, const uint8_t bits,
+              const uint32_t part);
+
+void pack_composition(void *rop, const uint32_t *comb, const uint16_t k,
+                      const uint16_t d, const uint8_t format);
+
+void unpack_composition(uint32_t *rop, const void *comb, const uint16_t k,
+                        const uint16_t d, const uint8_t format);
+
+void packed_unrank(const order *ord, void *rop, const uint16_t n,
+                   const uint16_t k, const uint16_t d, uintx_cref r,
+                   const uint8_t format, workspace_t *ws);
+
+uintx packed_rank(const order *ord, const void *comb, const uint16_t n,
+                  const uint16_t k, const uint16_t d, const uint8_t format,
+                  workspace_t *ws);
+
+void check_valid_packed_composition(const void *c, const uint16_t n,
+                                    const uint16_t k, const uint16_t d,
+                                    const uint8_t format);
+
+#endif
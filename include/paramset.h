@@ -0,0 +1,24 @@
+#ifndef PARAMSET_H
+#define PARAMSET_H
+
+#include "common.h"
+
+// pre-computed tables for a fixed (n, k, d), see `make tables`
+typedef struct {
+  const char *name;
+  uint16_t n;
+  uint16_t k;
+  uint16_t d;
+  const uintx *bin;
+  const uintx *comb;
+  const uintx *const *acc;
+} paramset_t;
+
+// terminated by an entry whose name is NULL
+extern const paramset_t PARAMSETS[];
+
+const paramset_t *find_paramset(const char *name);
+
+void load_caches(const paramset_t *set);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// where the limbs of heap-backed integers come from: thread-local free lists
+// of power-of-two blocks, or malloc and free for each of them
+enum {
+  POOL_ALLOC = 0,
+  SYSTEM_ALLOC = 1,
+  ALLOC_SENTINEL_LENGTH = 2,
+};
+
+extern int alloc_mode;
+
+// calls to malloc made by this layer, from any thread: every block under
+// SYSTEM_ALLOC, and only refills, large blocks and regions under POOL_ALLOC
+extern size_t system_allocations;
+
+// blocks bump-allocated together and released at once, for values that live
+// exactly as long as the cache holding them
+typedef struct {
+  void *chunks;
+  uint8_t lock;
+} region_t;
+
+void *pool_alloc(const size_t size);
+
+void *pool_realloc(void *ptr, const size_t old_size, const size_t new_size);
+
+// any block of this layer, whichever thread or region it came from
+void pool_free(void *ptr, const size_t size);
+
+// allocations of the calling thread come from `region`, or the pools if NULL,
+// until `region_leave` is given the region that this returns
+region_t *region_enter(region_t *region);
+
+void region_leave(region_t *previous);
+
+void region_free(region_t *region);
+
+// the free lists of the calling thread back to the system, as done when any
+// thread exits
+void pool_release(void);
+
+#if defined(__cplusplus)
+// for the `Allocator` parameter of `cpp_int_backend`
+template <class T> struct pool_allocator {
+  typedef T value_type;
+
+  pool_allocator() noexcept {}
+  template <class U> pool_allocator(const pool_allocator<U> &) noexcept {}
+
+  T *allocate(const size_t n) { return (T *)pool_alloc(n * sizeof(T)); }
+  void deallocate(T *p, const size_t n) noexcept {
+    pool_free(p, n * sizeof(T));
+  }
+};
+
+template <class T, class U>
+bool operator==(const pool_allocator<T> &, const pool_allocator<U> &) {
+  return true;
+}
+
+template <class T, class U>
+bool operator!=(const pool_allocator<T> &, const pool_allocator<U> &) {
+  return false;
+}
+#endif
+
+#endif
@@ -4,11 +4,12 @@
 #include "common.h"
 
 void inner_rbo_unrank(uint32_t *rop, const uint16_t n, const uint16_t k,
-                      const uint16_t d, const uintx r, const uint16_t start);
+                      const uint16_t d, uintx_cref r, const uint16_t start,
+                      workspace_t *ws);
 
 // §4.5 of 10.1007/978-3-031-22969-5_1
 void rbo_unrank(uint32_t *rop, const uint16_t n, const uint16_t k,
-                const uint16_t d, const uintx r);
+                const uint16_t d, uintx_cref r, workspace_t *ws);
 
 // §4.2 of 10.1007/978-3-031-22969-5_1
 uintx rbo_rank(const uint16_t n, const uint16_t k, const uint16_t d,
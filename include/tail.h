@@ -0,0 +1,46 @@
+#ifndef TAIL_H
+#define TAIL_H
+
+#include "common.h"
+
+// the last `parts` parts of every composition in colex and Gray order, for
+// each remaining sum up to `max_sum`, packed `bits` per part in one word
+typedef struct {
+  uint64_t *offsets;
+  uint64_t *colex;
+  uint64_t *gray;
+  uint16_t parts;
+  uint16_t max_sum;
+  uint8_t bits;
+  int budget;
+  uint16_t n;
+  uint16_t d;
+  size_t total_size;
+} tail_t;
+
+extern tail_t tail_cache;
+
+// KiB available to both tables, which are not built when zero
+extern int tail_budget;
+
+// the most parts whose tables fit in `tail_budget` for (n, k, d)
+void build_tail(const uint16_t n, const uint16_t k, const uint16_t d);
+
+// keep the tables when they still apply to (n, k, d), or rebuild them
+void grow_tail(const uint16_t n, const uint16_t k, const uint16_t d);
+
+void free_tail(void);
+
+// the parts `rop[0..parts - 1]` of rank `r` among those summing to `n`
+void tail_unrank(uint32_t *rop, const uint64_t *table, const uint16_t n,
+                 uintx_cref r);
+
+// whether an unranking at part `i` with a remaining sum `n` can finish with
+// one lookup
+static inline bool tail_covers(const uint16_t i, const uint16_t n,
+                               const uint16_t d) {
+  return i + 1 == tail_cache.parts && d == tail_cache.d &&
+         n <= tail_cache.max_sum;
+}
+
+#endif
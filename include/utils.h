@@ -38,10 +38,23 @@ typedef struct {
 // https://github.com/sphincs/sphincsplus/blob/7ec789ac/ref/test/cycles.c
 uint64_t cycles(void);
 
+// data TLB and L1 data cache load misses of this thread, read and closed by
+// the functions below, -1 when perf events are unavailable
+int32_t open_dtlb_misses(void);
+
+int32_t open_l1d_misses(void);
+
+int64_t read_misses(const int32_t fd);
+
+void close_misses(const int32_t fd);
+
 uint32_t min(const uint32_t a, const uint32_t b);
 
 int32_t max(const int32_t a, const int32_t b);
 
+void setup_part_iter(part_iter_t *it, const uint16_t n, const uint16_t k,
+                     const uint16_t d, uintx_cref r);
+
 void check_valid_bounded_composition(const uint32_t *c, const uint16_t n,
                                      const uint16_t k, const uint16_t d);
 
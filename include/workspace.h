@@ -0,0 +1,11 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include "common.h"
+
+void setup_workspace(workspace_t *ws, const uint16_t n, const uint16_t k,
+                     const uint16_t d);
+
+void free_workspace(workspace_t *ws);
+
+#endif
@@ -4,8 +4,9 @@ IT="${1:-$(make -pqrR | awk '/^IT/ { print $NF }')}"
 
 SECURITY="128 192 256"
 BACKENDS="bitint boost-fix"
+MULTI_BACKENDS="$(echo $BACKENDS | sed 's/bitint//; s/boost-//g')"
 ORDERS="colex gray rbo"
-ALGORITHMS="default ps al ab ad"
+ALGORITHMS="default ps al ab ad ai"
 CACHE_STRAT="bin comb scomb acc"
 
 for LEVEL in $SECURITY ; do
@@ -20,8 +21,15 @@ for LEVEL in $SECURITY ; do
         for CACHE in $CACHE_STRAT ; do
           RAW_DATA_PATH="$TMPDIR/c-$IMPL-cycles-test-m-$LEVEL-it-$IT-o-$ORD-a-$ALG-c-$CACHE.dat"
           echo "$IMPL-$ORD-$ALG-$CACHE" | tee "$RAW_DATA_PATH"
-          make --silent IT="$IT" ORDER="$ORD" ALG="$ALG" CACHE="$CACHE" \
-            clean "$IMPL" "test-$LEVEL" >> "$RAW_DATA_PATH"
+          # every backend but `bitint` shares one build of `bin/multi.c`
+          if [ $IMPL = "bitint" ] ; then
+            make --silent IT="$IT" ORDER="$ORD" ALG="$ALG" CACHE="$CACHE" \
+              clean "$IMPL" "test-$LEVEL" >> "$RAW_DATA_PATH"
+          else
+            make --silent IT="$IT" ORDER="$ORD" ALG="$ALG" CACHE="$CACHE" \
+              MULTI_BACKENDS="$MULTI_BACKENDS" BACKEND="$IMPL" \
+              multi "multi-$LEVEL" >> "$RAW_DATA_PATH"
+          fi
         done
       done
     done
@@ -32,7 +40,7 @@ for LEVEL in $SECURITY ; do
         NR == 1 { print "k", $0 }
         NR != 1 {
           printf "%6d", int($6)
-          for (i = 21; i <= NF; i += 29) {
+          for (i = 21; i <= NF; i += 38) {
             printf "%14.2Lf", $i
           }
           printf "\n"
@@ -45,7 +53,7 @@ for LEVEL in $SECURITY ; do
         NR == 1 { print "k", $0 }
         NR != 1 {
           printf "%6d", int($6)
-          for (i = 28; i <= NF; i += 29) {
+          for (i = 28; i <= NF; i += 38) {
             printf "%14.2Lf", $i
           }
           printf "\n"
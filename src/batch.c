@@ -0,0 +1,392 @@
+#include "batch.h"
+#include "cache.h"
+#include "math.h"
+#include "utils.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// limb `j` of entry 0 of the row at index 0, to which rows add their index
+static inline const uint64_t *limb(const batch_t *b, const uint16_t j) {
+  return b->sums + j * (b->d + 1);
+}
+
+// move the lanes in `active` along their rows, counting their parts, while the
+// rank is at least the entry `idx` over the low `limbs` limbs and the part is
+// below `bound`
+static void find_parts(const batch_t *b, const uint16_t limbs,
+                       const uint64_t *ranks, int64_t *idx, int64_t *part,
+                       const int64_t *bound, uint8_t active);
+
+// rank -= entry `idx` of its row, in every lane and the low `limbs` limbs
+static void lanes_sub(const batch_t *b, const uint16_t limbs, uint64_t *ranks,
+                      const int64_t *idx);
+
+// rank += entry `idx` of its row, in every lane and the low `limbs` limbs
+static void lanes_add(const batch_t *b, const uint16_t limbs, uint64_t *ranks,
+                      const int64_t *idx);
+
+#if defined(__AVX512F__)
+static inline __mmask8 lanes_geq(const batch_t *b, const uint16_t limbs,
+                                 const uint64_t *ranks, const __m512i index,
+                                 const __mmask8 mask) {
+  __mmask8 undecided = mask;
+  __mmask8 above = 0;
+
+  // from the top limb down, until every lane differs in one
+  for (uint16_t j = limbs; j-- > 0 && undecided;) {
+    const __m512i c = _mm512_mask_i64gather_epi64(
+        _mm512_setzero_si512(), undecided, index, limb(b, j), 8);
+    const __m512i r = _mm512_loadu_si512(ranks + j * BATCH_LANES);
+    above |= _mm512_mask_cmpgt_epu64_mask(undecided, r, c);
+    undecided = _mm512_mask_cmpeq_epu64_mask(undecided, r, c);
+  }
+
+  return above | undecided;
+}
+
+// the indices and parts stay in registers across steps, as storing them lane
+// by lane and loading them back as a vector stalls store forwarding
+static void find_parts(const batch_t *b, const uint16_t limbs,
+                       const uint64_t *ranks, int64_t *idx, int64_t *part,
+                       const int64_t *bound, uint8_t active) {
+  const __m512i one = _mm512_set1_epi64(1);
+  const __m512i bounds = _mm512_loadu_si512(bound);
+  __m512i index = _mm512_loadu_si512(idx);
+  __m512i parts = _mm512_loadu_si512(part);
+
+  while (active) {
+    active = lanes_geq(b, limbs, ranks, index, active);
+    index = _mm512_mask_add_epi64(index, active, index, one);
+    parts = _mm512_mask_add_epi64(parts, active, parts, one);
+    active = _mm512_mask_cmplt_epi64_mask(active, parts, bounds);
+  }
+
+  _mm512_storeu_si512(idx, index);
+  _mm512_storeu_si512(part, parts);
+}
+
+static void lanes_sub(const batch_t *b, const uint16_t limbs, uint64_t *ranks,
+                      const int64_t *idx) {
+  const __m512i index = _mm512_loadu_si512(idx);
+  const __m512i one = _mm512_set1_epi64(1);
+  __mmask8 borrow = 0;
+
+  for (uint16_t j = 0; j < limbs; ++j) {
+    const __m512i c = _mm512_mask_i64gather_epi64(
+        _mm512_setzero_si512(), 0xFF, index, limb(b, j), 8);
+    const __m512i r = _mm512_loadu_si512(ranks + j * BATCH_LANES);
+    __m512i diff = _mm512_sub_epi64(r, c);
+    diff = _mm512_mask_sub_epi64(diff, borrow, diff, one);
+    borrow = _mm512_cmplt_epu64_mask(r, c) |
+             _mm512_mask_cmpeq_epu64_mask(borrow, r, c);
+    _mm512_storeu_si512(ranks + j * BATCH_LANES, diff);
+  }
+}
+
+static void lanes_add(const batch_t *b, const uint16_t limbs, uint64_t *ranks,
+                      const int64_t *idx) {
+  const __m512i index = _mm512_loadu_si512(idx);
+  const __m512i one = _mm512_set1_epi64(1);
+  const __m512i top = _mm512_set1_epi64(-1);
+  __mmask8 carry = 0;
+
+  for (uint16_t j = 0; j < limbs; ++j) {
+    const __m512i c = _mm512_mask_i64gather_epi64(
+        _mm512_setzero_si512(), 0xFF, index, limb(b, j), 8);
+    const __m512i r = _mm512_loadu_si512(ranks + j * BATCH_LANES);
+    __m512i sum = _mm512_add_epi64(r, c);
+    const __mmask8 over = _mm512_cmplt_epu64_mask(sum, c) |
+                          _mm512_mask_cmpeq_epu64_mask(carry, sum, top);
+    sum = _mm512_mask_add_epi64(sum, carry, sum, one);
+    carry = over;
+    _mm512_storeu_si512(ranks + j * BATCH_LANES, sum);
+  }
+}
+#elif defined(__AVX2__)
+// AVX2 compares 64-bit lanes only as signed, so both sides are offset by 2^63,
+// and a lane is selected by all ones, four lanes per vector
+#define HALF_LANES (BATCH_LANES / 2)
+
+static inline __m256i lanes_above(const __m256i a, const __m256i b) {
+  const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+  return _mm256_cmpgt_epi64(_mm256_xor_si256(a, sign),
+                            _mm256_xor_si256(b, sign));
+}
+
+static inline __m256i lanes_of(const uint8_t mask) {
+  return _mm256_set_epi64x(-((mask >> 3) & 1), -((mask >> 2) & 1),
+                           -((mask >> 1) & 1), -(mask & 1));
+}
+
+static inline uint8_t mask_of(const __m256i v) {
+  return (uint8_t)_mm256_movemask_pd(_mm256_castsi256_pd(v));
+}
+
+static uint8_t lanes_geq(const batch_t *b, const uint16_t limbs,
+                         const uint64_t *ranks, const int64_t *idx,
+                         const uint8_t mask) {
+  uint8_t geq = 0;
+
+  for (uint8_t h = 0; h < 2; ++h) {
+    const __m256i index = _mm256_loadu_si256((const __m256i *)(idx + 4 * h));
+    uint8_t undecided = (mask >> (4 * h)) & 0xF;
+    uint8_t above = 0;
+
+    for (uint16_t j = limbs; j-- > 0 && undecided;) {
+      const __m256i c = _mm256_mask_i64gather_epi64(
+          _mm256_setzero_si256(), (const long long *)limb(b, j), index,
+          lanes_of(undecided), 8);
+      const __m256i r = _mm256_loadu_si256(
+          (const __m256i *)(ranks + j * BATCH_LANES + HALF_LANES * h));
+      above |= undecided & mask_of(lanes_above(r, c));
+      undecided &= mask_of(_mm256_cmpeq_epi64(r, c));
+    }
+
+    geq |= (above | undecided) << (4 * h);
+  }
+
+  return geq;
+}
+
+static void lanes_sub(const batch_t *b, const uint16_t limbs, uint64_t *ranks,
+                      const int64_t *idx) {
+  for (uint8_t h = 0; h < 2; ++h) {
+    const __m256i index = _mm256_loadu_si256((const __m256i *)(idx + 4 * h));
+    __m256i borrow = _mm256_setzero_si256();
+
+    for (uint16_t j = 0; j < limbs; ++j) {
+      __m256i *lane = (__m256i *)(ranks + j * BATCH_LANES + HALF_LANES * h);
+      const __m256i c =
+          _mm256_i64gather_epi64((const long long *)limb(b, j), index, 8);
+      const __m256i r = _mm256_loadu_si256(lane);
+      // a borrow of all ones subtracts one more
+      const __m256i diff = _mm256_add_epi64(_mm256_sub_epi64(r, c), borrow);
+      const __m256i ties = _mm256_and_si256(_mm256_cmpeq_epi64(r, c), borrow);
+      borrow = _mm256_or_si256(lanes_above(c, r), ties);
+      _mm256_storeu_si256(lane, diff);
+    }
+  }
+}
+
+static void lanes_add(const batch_t *b, const uint16_t limbs, uint64_t *ranks,
+                      const int64_t *idx) {
+  const __m256i top = _mm256_set1_epi64x(-1);
+
+  for (uint8_t h = 0; h < 2; ++h) {
+    const __m256i index = _mm256_loadu_si256((const __m256i *)(idx + 4 * h));
+    __m256i carry = _mm256_setzero_si256();
+
+    for (uint16_t j = 0; j < limbs; ++j) {
+      __m256i *lane = (__m256i *)(ranks + j * BATCH_LANES + HALF_LANES * h);
+      const __m256i c =
+          _mm256_i64gather_epi64((const long long *)limb(b, j), index, 8);
+      const __m256i sum = _mm256_add_epi64(_mm256_loadu_si256(lane), c);
+      // a carry of all ones adds one more
+      const __m256i wraps =
+          _mm256_and_si256(_mm256_cmpeq_epi64(sum, top), carry);
+      const __m256i over = _mm256_or_si256(lanes_above(c, sum), wraps);
+      _mm256_storeu_si256(lane, _mm256_sub_epi64(sum, carry));
+      carry = over;
+    }
+  }
+}
+#else
+static uint8_t lanes_geq(const batch_t *b, const uint16_t limbs,
+                         const uint64_t *ranks, const int64_t *idx,
+                         const uint8_t mask) {
+  uint8_t geq = 0;
+
+  for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+    if (!((mask >> l) & 1)) {
+      continue;
+    }
+    uint16_t j = limbs;
+    while (j-- > 0 && ranks[j * BATCH_LANES + l] == limb(b, j)[idx[l]]) {
+    }
+    if (j == UINT16_MAX ||
+        ranks[j * BATCH_LANES + l] > limb(b, j)[idx[l]]) {
+      geq |= 1 << l;
+    }
+  }
+
+  return geq;
+}
+
+static void lanes_sub(const batch_t *b, const uint16_t limbs, uint64_t *ranks,
+                      const int64_t *idx) {
+  for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+    uint64_t borrow = 0;
+    for (uint16_t j = 0; j < limbs; ++j) {
+      const uint64_t r = ranks[j * BATCH_LANES + l];
+      const uint64_t c = limb(b, j)[idx[l]];
+      ranks[j * BATCH_LANES + l] = r - c - borrow;
+      borrow = (r < c) || (r == c && borrow);
+    }
+  }
+}
+
+static void lanes_add(const batch_t *b, const uint16_t limbs, uint64_t *ranks,
+                      const int64_t *idx) {
+  for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+    uint64_t carry = 0;
+    for (uint16_t j = 0; j < limbs; ++j) {
+      const uint64_t c = limb(b, j)[idx[l]];
+      const uint64_t sum = ranks[j * BATCH_LANES + l] + c;
+      ranks[j * BATCH_LANES + l] = sum + carry;
+      carry = (sum < c) || (sum == UINT64_MAX && carry);
+    }
+  }
+}
+#endif
+
+#if !defined(__AVX512F__)
+static void find_parts(const batch_t *b, const uint16_t limbs,
+                       const uint64_t *ranks, int64_t *idx, int64_t *part,
+                       const int64_t *bound, uint8_t active) {
+  // lanes leave the mask as soon as their part is found, without branching
+  // on any single one
+  while (active) {
+    active = lanes_geq(b, limbs, ranks, idx, active);
+    uint8_t below = 0;
+    for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+      const int64_t step = (active >> l) & 1;
+      part[l] += step;
+      idx[l] += step;
+      below |= (part[l] < bound[l]) << l;
+    }
+    active &= below;
+  }
+}
+#endif
+
+static inline int64_t row_index(const batch_t *b, const uint16_t it_n,
+                                const uint16_t i) {
+  return ((int64_t)it_n * b->k + i) * (b->d + 1) * b->limbs;
+}
+
+void build_batch(batch_t *b, const uint16_t n, const uint16_t k,
+                 const uint16_t d) {
+  b->n = n;
+  b->k = k;
+  b->d = d;
+  b->limbs = (bits_fit_bic(n, k, d) + 63) / 64;
+  b->total_size =
+      (size_t)(n + 1) * k * (d + 1) * b->limbs * sizeof(uint64_t);
+  b->sums = (uint64_t *)calloc(b->total_size, 1);
+  assert(b->sums != NULL);
+  b->level_limbs = (uint16_t *)calloc(k, sizeof(uint16_t));
+  assert(b->level_limbs != NULL);
+  for (uint16_t i = 0; i < k; ++i) {
+    b->level_limbs[i] = 1;
+  }
+
+  uintx *buffer = (uintx *)calloc(d + 3, sizeof(uintx));
+  assert(buffer != NULL);
+
+  // rows out of reach of any composition may not fit the limbs, and are
+  // truncated as they are never read
+  for (uint16_t it_n = 0; it_n <= n; ++it_n) {
+    for (uint16_t i = 1; i < k; ++i) {
+      const uintx *sums = acc(it_n, i, d, buffer);
+      uint64_t *row = b->sums + row_index(b, it_n, i);
+      for (uint16_t p = 0; p <= min(it_n, d); ++p) {
+        for (uint16_t j = 0; j < b->limbs; ++j) {
+          row[j * (d + 1) + p] = (uint64_t)((sums[p] >> (64 * j)) & UINT64_MAX);
+        }
+      }
+
+      // the total of the row, past its last entry, bounds the ranks in it
+      const uint16_t total = (bit_length(sums[min(it_n, d) + 1]) + 63) / 64;
+      b->level_limbs[i] = min(max(b->level_limbs[i], total), b->limbs);
+    }
+  }
+
+  free(buffer);
+}
+
+void free_batch(batch_t *b) {
+  free(b->sums);
+  free(b->level_limbs);
+  b->sums = NULL;
+  b->level_limbs = NULL;
+}
+
+void batch_import(const batch_t *b, uint64_t *rop, const uintx *ranks) {
+  for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+    for (uint16_t j = 0; j < b->limbs; ++j) {
+      rop[j * BATCH_LANES + l] =
+          (uint64_t)((ranks[l] >> (64 * j)) & UINT64_MAX);
+    }
+  }
+}
+
+void batch_export(const batch_t *b, uintx *rop, const uint64_t *ranks) {
+  for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+    rop[l] = 0;
+    for (uint16_t j = b->limbs; j-- > 0;) {
+      rop[l] = (rop[l] << 64) | (uintx)ranks[j * BATCH_LANES + l];
+    }
+  }
+}
+
+void batch_unrank(const batch_t *b, uint32_t *rop, uint64_t *ranks) {
+  uint32_t it_n[BATCH_LANES];
+  int64_t part[BATCH_LANES];
+  int64_t bound[BATCH_LANES];
+  int64_t idx[BATCH_LANES];
+
+  for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+    it_n[l] = b->n;
+  }
+
+  for (uint16_t i = b->k - 1; i > 0; --i) {
+    uint8_t active = 0;
+
+    // every lane starts comparing against entry 1 of its own row
+    for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+      part[l] = 0;
+      bound[l] = min(it_n[l], b->d);
+      idx[l] = row_index(b, it_n[l], i) + 1;
+      // the top limbs of a row decide most comparisons
+      __builtin_prefetch(limb(b, b->level_limbs[i] - 1) + idx[l]);
+      active |= (bound[l] > 0) << l;
+    }
+
+    find_parts(b, b->level_limbs[i], ranks, idx, part, bound, active);
+
+    for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+      rop[i * BATCH_LANES + l] = part[l];
+      idx[l] -= 1;
+      it_n[l] -= part[l];
+    }
+    lanes_sub(b, b->level_limbs[i], ranks, idx);
+  }
+
+  for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+    rop[l] = it_n[l];
+  }
+}
+
+void batch_rank(const batch_t *b, uint64_t *rop, const uint32_t *comb) {
+  uint16_t it_n[BATCH_LANES];
+  int64_t idx[BATCH_LANES];
+
+  memset(rop, 0, b->limbs * BATCH_LANES * sizeof(uint64_t));
+  for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+    it_n[l] = b->n;
+  }
+
+  for (uint16_t i = b->k - 1; i > 0; --i) {
+    const uint32_t *part = comb + i * BATCH_LANES;
+    for (uint8_t l = 0; l < BATCH_LANES; ++l) {
+      idx[l] = row_index(b, it_n[l], i) + part[l];
+      it_n[l] -= part[l];
+    }
+    lanes_add(b, b->limbs, rop, idx);
+  }
+}
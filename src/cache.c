@@ -1,7 +1,17 @@
+#if !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include "cache.h"
 #include "math.h"
+#include "tail.h"
 #include "utils.h"
 
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #if defined(DHAT)
 #include <valgrind/dhat.h>
 #endif
@@ -10,66 +20,613 @@ cache_t bin_cache_t;
 cache_t comb_cache_t;
 cache_t acc_cache_t;
 cache_t scomb_cache_t;
+cache_t pascal_cache_t;
+
+// earlier, smaller Pascal tables, kept alive for the views still reading them
+static cache_t retired_pascal[64];
+static size_t num_retired_pascal = 0;
 
 int cache_type = NO_CACHE;
+int cache_layout = ROW_MAJOR_LAYOUT;
+int cache_pages = BASE_PAGES;
+int cache_fill = EAGER_FILL;
+int cache_sums = ROW_SUMS;
+
+static const cache_t *all_caches[] = {&bin_cache_t, &comb_cache_t,
+                                      &scomb_cache_t, &acc_cache_t};
+
+uint32_t row_major_index(const cache_t *cache, const uint32_t row,
+                         const uint32_t col) {
+  return row * cache->stride + col;
+}
+
+uint32_t band_index(const cache_t *cache, const uint32_t row,
+                    const uint32_t col) {
+  const band_t *band = &cache->band[col];
+  return band->offset + min(row, band->top - row) - band->lo;
+}
+
+// rows of a column are adjacent, as a level of unranking scans them
+uint32_t column_major_index(const cache_t *cache, const uint32_t row,
+                            const uint32_t col) {
+  return col * cache->stride + row;
+}
+
+// tiles in row-major order, each column-major inside, so that the next level
+// usually starts in the tile the last one ended in
+uint32_t tiled_index(const cache_t *cache, const uint32_t row,
+                     const uint32_t col) {
+  uint32_t tile = (row / TILE_SIDE) * cache->stride + col / TILE_SIDE;
+  return (tile * TILE_SIDE + col % TILE_SIDE) * TILE_SIDE + row % TILE_SIDE;
+}
+
+bool cache_contains(const cache_t *cache, const uint32_t row,
+                    const uint32_t col) {
+  if (row >= cache->rows || col >= cache->cols) {
+    return false;
+  }
+  if (cache->band == NULL) {
+    return true;
+  }
+
+  const band_t *band = &cache->band[col];
+  if (row > band->top) {
+    return false;
+  }
+  uint32_t folded = min(row, band->top - row);
+  return band->lo <= folded && folded <= band->hi;
+}
 
 void *cache_get_element(const cache_t *cache, const uint32_t row,
                         const uint32_t col) {
-  uint32_t index = row * cache->cols + col;
+  uint32_t index = cache->index(cache, row, col);
   size_t offset = index * cache->elem_size;
   return (char *)cache->data + offset;
 }
 
+static bool transparent_huge_pages(void) {
+  FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+  if (f == NULL) {
+    return false;
+  }
+
+  char mode[64] = {0};
+  bool enabled = fgets(mode, sizeof(mode), f) != NULL &&
+                 strstr(mode, "[never]") == NULL;
+  fclose(f);
+  return enabled;
+}
+
+static void *map_aligned(const size_t length) {
+  // over-allocate by a huge page and trim, so that the kernel can back it
+  size_t padded = length + HUGE_PAGE_SIZE;
+  char *base = (char *)mmap(NULL, padded, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+
+  uintptr_t addr = (uintptr_t)base;
+  char *aligned =
+      (char *)((addr + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+  size_t head = aligned - base;
+  if (head > 0) {
+    munmap(base, head);
+  }
+  if (padded - head - length > 0) {
+    munmap(aligned + length, padded - head - length);
+  }
+  return aligned;
+}
+
+void cache_alloc(cache_t *cache, const size_t nmemb, const size_t size) {
+  size_t length = nmemb * size;
+  cache->page_size = sysconf(_SC_PAGESIZE);
+  cache->mapped_size = 0;
+
+  if (cache_pages == HUGE_PAGES && length > 0) {
+    size_t rounded = (length + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+    // explicit huge pages, only if reserved in /proc/sys/vm/nr_hugepages
+    void *data = mmap(NULL, rounded, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+      cache->data = data;
+      cache->page_size = HUGE_PAGE_SIZE;
+      cache->mapped_size = rounded;
+      return;
+    }
+
+    // otherwise transparent ones, which the kernel may still refuse
+    data = map_aligned(rounded);
+    if (data != NULL) {
+      if (madvise(data, rounded, MADV_HUGEPAGE) == 0 &&
+          transparent_huge_pages()) {
+        cache->page_size = HUGE_PAGE_SIZE;
+      }
+      cache->data = data;
+      cache->mapped_size = rounded;
+      return;
+    }
+  }
+
+  cache->data = calloc(nmemb, size);
+  assert(cache->data != NULL);
+}
+
+void cache_dealloc(cache_t *cache) {
+  if (cache->mapped_size > 0) {
+    munmap(cache->data, cache->mapped_size);
+  } else {
+    free(cache->data);
+  }
+  cache->data = NULL;
+  cache->mapped_size = 0;
+}
+
+size_t caches_page_size(void) {
+  size_t page_size = 0;
+  for (uint8_t i = 1; i <= cache_type; ++i) {
+    size_t size = all_caches[i - 1]->page_size;
+    if (page_size == 0 || size < page_size) {
+      page_size = size;
+    }
+  }
+  return page_size;
+}
+
 void generic_setup_cache(cache_t *cache, const uint32_t rows,
                          const uint32_t cols, const size_t elem_size,
                          char *name, uint8_t type) {
   cache->rows = rows;
   cache->cols = cols;
+  cache->stride = cols;
   cache->elem_size = elem_size;
   cache->total_size = cache->rows * cache->cols * cache->elem_size;
+  cache->cells = cache->rows * cache->cols;
   cache->name = name;
   cache->type = type;
+  cache->index = row_major_index;
+  cache->band = NULL;
+  cache->is_static = false;
+  cache->state = NULL;
+  cache->row_length = 0;
+  cache->layout = ROW_MAJOR_LAYOUT;
 
-  cache->data = calloc(cache->rows * cache->cols, cache->elem_size);
-  assert(cache->data != NULL);
+  cache_alloc(cache, cache->rows * cache->cols, cache->elem_size);
+}
+
+void layout_setup_cache(cache_t *cache, const uint32_t rows,
+                        const uint32_t cols, const size_t elem_size,
+                        char *name, uint8_t type, uint8_t layout) {
+  assert(layout != BAND_LAYOUT);
+  if (layout == ROW_MAJOR_LAYOUT) {
+    generic_setup_cache(cache, rows, cols, elem_size, name, type);
+    return;
+  }
+
+  // whole tiles, even at the edges of the table
+  uint32_t padded_rows = rows;
+  uint32_t padded_cols = cols;
+  cache->stride = rows;
+  cache->index = column_major_index;
+  if (layout == TILED_LAYOUT) {
+    padded_rows = (rows + TILE_SIDE - 1) / TILE_SIDE * TILE_SIDE;
+    padded_cols = (cols + TILE_SIDE - 1) / TILE_SIDE * TILE_SIDE;
+    cache->stride = padded_cols / TILE_SIDE;
+    cache->index = tiled_index;
+  }
+
+  cache->rows = rows;
+  cache->cols = cols;
+  cache->elem_size = elem_size;
+  cache->cells = padded_rows * padded_cols;
+  cache->total_size = cache->cells * cache->elem_size;
+  cache->name = name;
+  cache->type = type;
+  cache->band = NULL;
+  cache->is_static = false;
+  cache->state = NULL;
+  cache->row_length = 0;
+  cache->layout = layout;
+
+  cache_alloc(cache, cache->cells, cache->elem_size);
+}
+
+void static_setup_cache(cache_t *cache, const void *data, const uint32_t rows,
+                        const uint32_t cols, const size_t elem_size,
+                        char *name, uint8_t type) {
+  cache->rows = rows;
+  cache->cols = cols;
+  cache->stride = cols;
+  cache->elem_size = elem_size;
+  cache->total_size = cache->rows * cache->cols * cache->elem_size;
+  cache->name = name;
+  cache->type = type;
+  cache->index = row_major_index;
+  cache->band = NULL;
+  cache->is_static = true;
+  cache->state = NULL;
+  cache->row_length = 0;
+  cache->layout = ROW_MAJOR_LAYOUT;
+  cache->cells = rows * cols;
+  cache->page_size = sysconf(_SC_PAGESIZE);
+  cache->mapped_size = 0;
+
+  // never written to, as the tables are only read after being built
+  cache->data = (void *)data;
+}
+
+void arena_setup_cache(cache_t *cache, const uint32_t rows, const uint32_t cols,
+                       const size_t length, char *name, uint8_t type) {
+  cache->rows = rows;
+  cache->cols = cols;
+  cache->stride = cols;
+  cache->elem_size = sizeof(uintx *);
+  cache->name = name;
+  cache->type = type;
+  cache->index = row_major_index;
+  cache->band = NULL;
+  cache->is_static = false;
+  cache->state = NULL;
+  cache->cells = rows * cols;
+  cache->row_length = length;
+  cache->layout = ROW_MAJOR_LAYOUT;
+
+  // rows start on a cache line, past the table of pointers to them
+  size_t table = (rows * cols * sizeof(uintx *) + 63) & ~(size_t)63;
+  cache->total_size = table + rows * cols * length * sizeof(uintx);
+  cache_alloc(cache, cache->total_size, 1);
+
+  uintx *row = (uintx *)((char *)cache->data + table);
+  for (uint32_t i = 0; i < rows * cols; ++i, row += length) {
+    ((uintx **)cache->data)[i] = row;
+  }
+}
+
+void band_setup_cache(cache_t *cache, const uint16_t n, const uint16_t k,
+                      const uint16_t d, char *name, uint8_t type) {
+  cache->rows = n + 1;
+  cache->cols = k + 1;
+  cache->elem_size = sizeof(uintx);
+  cache->name = name;
+  cache->type = type;
+  cache->index = band_index;
+  cache->is_static = false;
+  cache->state = NULL;
+  cache->row_length = 0;
+  cache->layout = BAND_LAYOUT;
+
+  cache->band = (band_t *)calloc(cache->cols, sizeof(band_t));
+  assert(cache->band != NULL);
+
+  uint32_t length = 0;
+  for (uint32_t col = 0; col < cache->cols; ++col) {
+    band_t *band = &cache->band[col];
+    band->top = col * d;
+    band->offset = length;
+
+    // unranking with `col` parts left only reaches sums the others can cover
+    uint32_t lo = max(n - (k - col) * d, 0);
+    uint32_t hi = min(n, band->top);
+    if (lo > hi) {
+      band->lo = 1;
+      band->hi = 0;
+      continue;
+    }
+
+    uint32_t mid = band->top / 2;
+    band->lo = min(lo, band->top - hi);
+    if (hi <= mid) {
+      band->hi = hi;
+    } else if (lo > mid) {
+      band->hi = band->top - lo;
+    } else {
+      band->hi = mid;
+    }
+    length += band->hi - band->lo + 1;
+  }
+
+  cache->total_size =
+      length * cache->elem_size + cache->cols * sizeof(band_t);
+
+  cache->cells = length;
+  cache_alloc(cache, length, cache->elem_size);
+}
+
+void lazy_setup_cache(cache_t *cache) {
+  cache->filled = 0;
+  cache->state = (uint8_t *)calloc(cache->cells, sizeof(uint8_t));
+  assert(cache->state != NULL);
+  cache->total_size += cache->cells * sizeof(uint8_t);
+}
+
+// claim an empty cell for filling, or tell whether it is already ready
+static bool claim_cell(uint8_t *state, bool *ready) {
+  uint8_t expected = __atomic_load_n(state, __ATOMIC_ACQUIRE);
+  if (expected == CELL_EMPTY &&
+      __atomic_compare_exchange_n(state, &expected, CELL_BUSY, false,
+                                  __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+    *ready = false;
+    return true;
+  }
+  *ready = expected == CELL_READY;
+  return false;
+}
+
+static void publish_cell(cache_t *cache, uint8_t *state) {
+  __atomic_fetch_add(&cache->filled, 1, __ATOMIC_RELAXED);
+  __atomic_store_n(state, CELL_READY, __ATOMIC_RELEASE);
+}
+
+const uintx *lazy_comb(const uint16_t n, const uint16_t k, const uint16_t d,
+                       uintx *buffer) {
+  uint32_t index = comb_cache_t.index(&comb_cache_t, n, k);
+  uintx *cell = (uintx *)comb_cache_t.data + index;
+  uint8_t *state = &comb_cache_t.state[index];
+
+  bool ready = false;
+  if (!claim_cell(state, &ready)) {
+    if (ready) {
+      return cell;
+    }
+    *buffer = inner_bic(n, k, d);
+    return buffer;
+  }
+
+  // the first column as the eager build
+  region_t *outer = region_enter(&comb_cache_t.region);
+  *cell = (k == 0) ? (uintx)(n == 0) : inner_bic(n, k, d);
+  region_leave(outer);
+  publish_cell(&comb_cache_t, state);
+  return cell;
+}
+
+uintx *lazy_acc(const uint16_t n, const uint16_t k, const uint16_t d,
+                uintx *buffer) {
+  uint32_t index = acc_cache_t.index(&acc_cache_t, n, k);
+  uintx *row = ((uintx **)acc_cache_t.data)[index];
+  uint8_t *state = &acc_cache_t.state[index];
+
+  bool ready = false;
+  if (!claim_cell(state, &ready)) {
+    if (ready) {
+      return row;
+    }
+    if (buffer != NULL) {
+      return inner_acc(buffer, n, k, d);
+    }
+    while (__atomic_load_n(state, __ATOMIC_ACQUIRE) != CELL_READY) {
+    }
+    return row;
+  }
+
+  region_t *outer = region_enter(&acc_cache_t.region);
+  inner_acc(row, n, k, d);
+  region_leave(outer);
+  publish_cell(&acc_cache_t, state);
+  return row;
+}
+
+// P(n, k) - P(below - 1, k) into `rop`, subtracted in place, the latter being
+// zero for the entries that reach below the first row
+static void prefix_diff(uintx *rop, const uint16_t n, const uint16_t k,
+                        const uint16_t below) {
+  *rop = GET_CACHE_PREFIX(n, k);
+  if (below > 0) {
+    *rop -= GET_CACHE_PREFIX(below - 1, k);
+  }
+}
+
+uintx prefix_bic_acc(const uint16_t n, const uint16_t k, const uint16_t l) {
+  uintx rop = 0;
+  prefix_diff(&rop, n, k, n + 1 - l);
+  return rop;
+}
+
+uintx *prefix_acc(const uint16_t n, const uint16_t k, const uint16_t d,
+                  uintx *buffer) {
+  uint16_t i = 0;
+
+  buffer[0] = 0;
+  for (; i <= min(n, d); ++i) {
+    prefix_diff(&buffer[i + 1], n, k, n - i);
+  }
+  buffer[d + 2] = i;
+
+  return buffer;
+}
+
+// P(row, col) from the cell above it, which is already there
+static void prefix_fill(const uint16_t row, const uint16_t col,
+                        const uint16_t d) {
+  uintx *cell = &GET_CACHE_PREFIX(row, col);
+  const uintx *count = bic_view(row, col, d, cell);
+  if (count != cell) {
+    *cell = *count;
+  }
+  if (row > 0) {
+    *cell += GET_CACHE_PREFIX(row - 1, col);
+  }
 }
 
-void after_cache_build(cache_t *cache) {
-  (void)cache;
+void after_cache_build(cache_t *cache, const uint16_t n, const uint16_t k,
+                       const uint16_t d) {
+  cache->n = n;
+  cache->k = k;
+  cache->d = d;
+  if (cache->state == NULL) {
+    cache->filled = cache->cells;
+  }
 #if defined(DHAT)
   DHAT_HISTOGRAM_MEMORY(cache->data);
 #endif
 }
 
-void bin_build_cache(const uint16_t n, const uint16_t k, const uint16_t d) {
-  (void)d;
-  generic_setup_cache(&bin_cache_t, n + k + 1, k, sizeof(uintx), (char *)"bin",
-                      BIN_CACHE);
+// binomials beyond the integer width saturate, as no caller may reach them
+static uintx saturating_add(uintx_cref a, uintx_cref b) {
+#if defined(BITINT) || defined(BOOST_FIX_INT) || defined(BOOST_UINT_INT)
+  const uintx top = ~(uintx)0;
+  if (a > top - b) {
+    return top;
+  }
+#endif
+  return a + b;
+}
+
+static void free_pascal_cache(void) {
+  for (size_t i = 0; i < num_retired_pascal; ++i) {
+    free(retired_pascal[i].band);
+    cache_dealloc(&retired_pascal[i]);
+  }
+  num_retired_pascal = 0;
+  free(pascal_cache_t.band);
+  cache_dealloc(&pascal_cache_t);
+  region_free(&pascal_cache_t.region);
+}
+
+// columns of the Pascal triangle are stored one after the other, each as long
+// as the largest sum it was needed for, since small `k` reach far larger `n`
+uint32_t column_index(const cache_t *cache, const uint32_t row,
+                      const uint32_t col) {
+  return cache->band[col].offset + row;
+}
+
+void pascal_grow_cache(const uint32_t rows, const uint32_t cols) {
+  cache_t old = pascal_cache_t;
+  if (cols == 0 || (cols <= old.cols && rows <= old.band[cols - 1].hi + 1)) {
+    return;
+  }
 
-  GET_CACHE_BIN(0, 0) = 1;
-  for (uint32_t row = 1; row < bin_cache_t.rows; ++row) {
-    GET_CACHE_BIN(row, 0) = 1;
-    for (uint16_t col = 1; col <= min(row, bin_cache_t.cols - 1); ++col) {
-      GET_CACHE_BIN(row, col) = (uintx)GET_CACHE_BIN(row - 1, col - 1) +
-                                (uintx)GET_CACHE_BIN(row - 1, col);
+  // grow geometrically, so that a slowly increasing search copies little
+  uint32_t target = rows;
+  if (cols <= old.cols) {
+    target = max(rows, (old.band[cols - 1].hi + 1) * 3 / 2);
+  }
+
+  pascal_cache_t.cols = max(cols, old.cols);
+  pascal_cache_t.band = (band_t *)calloc(pascal_cache_t.cols, sizeof(band_t));
+  assert(pascal_cache_t.band != NULL);
+
+  // lengths stay non-increasing along the columns, as each needs the previous
+  uint32_t length = 0;
+  for (uint32_t col = 0; col < pascal_cache_t.cols; ++col) {
+    uint32_t old_length = (col < old.cols) ? old.band[col].hi + 1 : 0;
+    uint32_t new_length = old_length;
+    if (col < cols && target > new_length) {
+      new_length = target;
+    }
+    band_t *band = &pascal_cache_t.band[col];
+    band->lo = 0;
+    band->hi = new_length - 1;
+    band->offset = length;
+    length += new_length;
+  }
+
+  pascal_cache_t.rows = pascal_cache_t.band[0].hi + 1;
+  pascal_cache_t.stride = 0;
+  pascal_cache_t.elem_size = sizeof(uintx);
+  pascal_cache_t.name = (char *)"pascal";
+  pascal_cache_t.type = BIN_CACHE;
+  pascal_cache_t.index = column_index;
+  pascal_cache_t.is_static = false;
+  pascal_cache_t.state = NULL;
+  pascal_cache_t.row_length = 0;
+  pascal_cache_t.cells = length;
+  pascal_cache_t.filled = length;
+  pascal_cache_t.total_size =
+      length * sizeof(uintx) + pascal_cache_t.cols * sizeof(band_t);
+  cache_alloc(&pascal_cache_t, length, sizeof(uintx));
+
+  // one region for every table, as the retired ones share the cells copied,
+  // whichever cache is being filled when the triangle has to grow
+  region_t *outer = region_enter(&pascal_cache_t.region);
+  for (uint32_t col = 0; col < pascal_cache_t.cols; ++col) {
+    uint32_t old_length = (col < old.cols) ? old.band[col].hi + 1 : 0;
+    if (old_length > 0) {
+      memcpy((void *)&GET_CACHE_PASCAL(0, col),
+             (void *)((uintx *)old.data + old.band[col].offset),
+             old_length * sizeof(uintx));
+    }
+
+    for (uint32_t row = old_length; row <= pascal_cache_t.band[col].hi; ++row) {
+      if (col == 0 || row == 0) {
+        GET_CACHE_PASCAL(row, col) = (col == 0);
+      } else {
+        GET_CACHE_PASCAL(row, col) =
+            saturating_add(GET_CACHE_PASCAL(row - 1, col - 1),
+                           GET_CACHE_PASCAL(row - 1, col));
+      }
     }
   }
+  region_leave(outer);
 
-  after_cache_build(&bin_cache_t);
+  if (old.data == NULL) {
+    atexit(free_pascal_cache);
+    return;
+  }
+  assert(num_retired_pascal < sizeof(retired_pascal) / sizeof(cache_t));
+  retired_pascal[num_retired_pascal++] = old;
+}
+
+void bin_build_cache(const uint16_t n, const uint16_t k, const uint16_t d) {
+  pascal_grow_cache(n + k + 1, k);
+
+  // a view of the shared table, which outlives it
+  bin_cache_t = pascal_cache_t;
+  bin_cache_t.rows = n + k + 1;
+  bin_cache_t.cols = k;
+  bin_cache_t.cells = bin_cache_t.rows * bin_cache_t.cols;
+  bin_cache_t.total_size = bin_cache_t.cells * bin_cache_t.elem_size;
+  bin_cache_t.name = (char *)"bin";
+  bin_cache_t.is_static = true;
+
+  after_cache_build(&bin_cache_t, n, k, d);
 }
 
 void comb_build_cache(const uint16_t n, const uint16_t k, const uint16_t d) {
-  generic_setup_cache(&comb_cache_t, n + 1, k + 1, sizeof(uintx),
-                      (char *)"comb", COMB_CACHE);
+  if (cache_layout == BAND_LAYOUT) {
+    band_setup_cache(&comb_cache_t, n, k, d, (char *)"comb", COMB_CACHE);
+    if (cache_fill == LAZY_FILL) {
+      lazy_setup_cache(&comb_cache_t);
+      after_cache_build(&comb_cache_t, n, k, d);
+      return;
+    }
+
+    region_t *outer = region_enter(&comb_cache_t.region);
+    GET_CACHE_COMB(0, 0) = 1;
+    for (uint16_t col = 1; col < comb_cache_t.cols; ++col) {
+      const band_t *band = &comb_cache_t.band[col];
+      for (uint32_t row = band->lo; row <= band->hi; ++row) {
+        GET_CACHE_COMB(row, col) = inner_bic(row, col, d);
+      }
+    }
+    region_leave(outer);
+
+    after_cache_build(&comb_cache_t, n, k, d);
+    return;
+  }
 
-  GET_CACHE_COMB(0, 0) = 1;
+  layout_setup_cache(&comb_cache_t, n + 1, k + 1, sizeof(uintx),
+                     (char *)"comb", COMB_CACHE, cache_layout);
+  if (cache_fill == LAZY_FILL) {
+    lazy_setup_cache(&comb_cache_t);
+    after_cache_build(&comb_cache_t, n, k, d);
+    return;
+  }
+
+  // the first column too, as `bic_view` reads cells in place, which must
+  // then hold a constructed integer rather than zeroed memory
+  region_t *outer = region_enter(&comb_cache_t.region);
   for (uint16_t row = 0; row < comb_cache_t.rows; ++row) {
+    GET_CACHE_COMB(row, 0) = (row == 0);
     for (uint16_t col = 1; col < comb_cache_t.cols; ++col) {
       GET_CACHE_COMB(row, col) = inner_bic(row, col, d);
     }
   }
+  region_leave(outer);
 
-  after_cache_build(&comb_cache_t);
+  after_cache_build(&comb_cache_t, n, k, d);
 }
 
 void scomb_build_cache(const uint16_t n, const uint16_t k, const uint16_t d) {
@@ -78,6 +635,7 @@ void scomb_build_cache(const uint16_t n, const uint16_t k, const uint16_t d) {
 
   double variance = d * (d + 2) / 12;
   uint8_t level = 4;
+  region_t *outer = region_enter(&scomb_cache_t.region);
 
   for (uint16_t col = 0; col < scomb_cache_t.cols; ++col) {
     uint16_t j = col + 1;
@@ -98,51 +656,262 @@ void scomb_build_cache(const uint16_t n, const uint16_t k, const uint16_t d) {
     GET_CACHE_SCOMB(0, col) = part;
     scomb_cache_t.total_size += length * sizeof(uintx);
   }
+  region_leave(outer);
 
-  after_cache_build(&scomb_cache_t);
+  after_cache_build(&scomb_cache_t, n, k, d);
 }
 
 void acc_build_cache(const uint16_t n, const uint16_t k, const uint16_t d) {
-  generic_setup_cache(&acc_cache_t, n + 1, k, sizeof(uintx *), (char *)"acc",
-                      ACC_COMB_CACHE);
+  if (cache_sums == PREFIX_SUMS) {
+    generic_setup_cache(&acc_cache_t, n + 1, k, sizeof(uintx),
+                        (char *)"prefix", ACC_COMB_CACHE);
+    region_t *outer = region_enter(&acc_cache_t.region);
+    for (uint16_t row = 0; row < acc_cache_t.rows; ++row) {
+      for (uint16_t col = 0; col < acc_cache_t.cols; ++col) {
+        prefix_fill(row, col, d);
+      }
+    }
+    region_leave(outer);
+
+    after_cache_build(&acc_cache_t, n, k, d);
+    return;
+  }
+
+  arena_setup_cache(&acc_cache_t, n + 1, k, d + 3, (char *)"acc",
+                    ACC_COMB_CACHE);
+  if (cache_fill == LAZY_FILL) {
+    lazy_setup_cache(&acc_cache_t);
+    after_cache_build(&acc_cache_t, n, k, d);
+    return;
+  }
 
+  region_t *outer = region_enter(&acc_cache_t.region);
   for (uint16_t row = 0; row < acc_cache_t.rows; ++row) {
     for (uint16_t col = 0; col < acc_cache_t.cols; ++col) {
-      GET_CACHE_ACC(row, col) = inner_acc(row, col, d);
+      inner_acc(GET_CACHE_ACC(row, col), row, col, d);
     }
   }
+  region_leave(outer);
 
-  after_cache_build(&acc_cache_t);
+  after_cache_build(&acc_cache_t, n, k, d);
 }
 
 void build_caches(const uint16_t n, const uint16_t k, const uint16_t d) {
   for (uint8_t i = 1; i <= cache_type; ++i) {
     cache_builders[i](n, k, d);
   }
+  build_tail(n, k, d);
 }
 
-void bin_free_cache() { free(bin_cache_t.data); }
+// whether `cache` holds every cell for (n, k, d), if it was built for `d`
+static bool cache_covers(const cache_t *cache, const uint32_t rows,
+                         const uint32_t cols, const uint16_t d) {
+  return cache->data != NULL && !cache->is_static && cache->d == d &&
+         (cache->state != NULL) == (cache_fill == LAZY_FILL) &&
+         rows <= cache->rows && cols <= cache->cols;
+}
 
-void comb_free_cache() { free(comb_cache_t.data); }
+// move `cache` to a `rows` by `cols` table, keeping the cells already there
+static void resize_cache(cache_t *cache, const uint32_t rows,
+                         const uint32_t cols) {
+  cache_t old = *cache;
+  if (old.row_length > 0) {
+    arena_setup_cache(cache, rows, cols, old.row_length, old.name, old.type);
+  } else {
+    layout_setup_cache(cache, rows, cols, old.elem_size, old.name, old.type,
+                       old.layout);
+  }
+  if (old.state != NULL) {
+    lazy_setup_cache(cache);
+    cache->filled = old.filled;
+  }
 
-void scomb_free_cache() {
-  for (uint16_t j = 0; j < scomb_cache_t.cols; ++j) {
-    free(GET_CACHE_SCOMB(0, j));
+  for (uint32_t row = 0; row < old.rows; ++row) {
+    for (uint32_t col = 0; col < old.cols; ++col) {
+      uint32_t from = old.index(&old, row, col);
+      uint32_t to = cache->index(cache, row, col);
+      if (old.row_length > 0) {
+        memcpy((void *)((uintx **)cache->data)[to],
+               (void *)((uintx **)old.data)[from],
+               old.row_length * sizeof(uintx));
+      } else {
+        memcpy((char *)cache->data + to * cache->elem_size,
+               (char *)old.data + from * old.elem_size, old.elem_size);
+      }
+      if (old.state != NULL) {
+        cache->state[to] = old.state[from];
+      }
+    }
   }
-  free(scomb_cache_t.data);
+
+  // the cells copied keep their limbs
+  old.region.chunks = NULL;
+  generic_free_cache(&old);
 }
 
-void acc_free_cache() {
-  for (uint16_t i = 0; i < acc_cache_t.rows; ++i) {
-    for (uint16_t j = 0; j < acc_cache_t.cols; ++j) {
-      free(GET_CACHE_ACC(i, j));
+void bin_grow_cache(const uint16_t n, const uint16_t k, const uint16_t d) {
+  // the view covers every (n, k) seen since the caches were last freed, as
+  // the grown comb and acc caches reach binomials for both at once
+  if (bin_cache_t.data != NULL) {
+    bin_build_cache(max(n, bin_cache_t.n), max(k, bin_cache_t.k), d);
+    return;
+  }
+  bin_build_cache(n, k, d);
+}
+
+void comb_grow_cache(const uint16_t n, const uint16_t k, const uint16_t d) {
+  uint32_t rows = n + 1;
+  uint32_t cols = k + 1;
+
+  // the band of reachable sums moves with `n` and `k`, so it is only reused
+  // for the very same parameters
+  if (cache_layout == BAND_LAYOUT || comb_cache_t.band != NULL) {
+    if (cache_layout == BAND_LAYOUT && comb_cache_t.band != NULL &&
+        cache_covers(&comb_cache_t, rows, cols, d) && comb_cache_t.n == n &&
+        comb_cache_t.k == k) {
+      return;
+    }
+    comb_free_cache();
+    comb_build_cache(n, k, d);
+    return;
+  }
+
+  // cells only keep their place within the same layout
+  if (cache_covers(&comb_cache_t, rows, cols, d) &&
+      comb_cache_t.layout == cache_layout) {
+    return;
+  }
+  if (!cache_covers(&comb_cache_t, 0, 0, d) ||
+      comb_cache_t.layout != cache_layout) {
+    comb_free_cache();
+    comb_build_cache(n, k, d);
+    return;
+  }
+
+  uint32_t old_rows = comb_cache_t.rows;
+  uint32_t old_cols = comb_cache_t.cols;
+  resize_cache(&comb_cache_t, max(rows, old_rows), max(cols, old_cols));
+
+  if (comb_cache_t.state == NULL) {
+    region_t *outer = region_enter(&comb_cache_t.region);
+    for (uint16_t row = 0; row < comb_cache_t.rows; ++row) {
+      uint16_t col = (row < old_rows) ? old_cols : 1;
+      if (row >= old_rows) {
+        GET_CACHE_COMB(row, 0) = 0;
+      }
+      for (; col < comb_cache_t.cols; ++col) {
+        GET_CACHE_COMB(row, col) = inner_bic(row, col, d);
+      }
     }
+    region_leave(outer);
+  }
+
+  after_cache_build(&comb_cache_t, comb_cache_t.rows - 1,
+                    comb_cache_t.cols - 1, d);
+}
+
+void scomb_grow_cache(const uint16_t n, const uint16_t k, const uint16_t d) {
+  // the rows are centered on the mean part for (n, k, d), so never reused
+  if (scomb_cache_t.data != NULL && scomb_cache_t.n == n &&
+      scomb_cache_t.k == k && scomb_cache_t.d == d) {
+    return;
+  }
+  if (scomb_cache_t.data != NULL) {
+    scomb_free_cache();
+  }
+  scomb_build_cache(n, k, d);
+}
+
+// whether the acc cache holds every cell for (n, k, d) the way `cache_sums`
+// asks for, the prefix sums being filled eagerly whatever `cache_fill`
+static bool acc_covers(const uint32_t rows, const uint32_t cols,
+                       const uint16_t d) {
+  if (cache_sums == PREFIX_SUMS) {
+    return acc_cache_t.data != NULL && !acc_cache_t.is_static &&
+           acc_cache_t.row_length == 0 && acc_cache_t.d == d &&
+           rows <= acc_cache_t.rows && cols <= acc_cache_t.cols;
   }
-  free(acc_cache_t.data);
+  return acc_cache_t.row_length > 0 &&
+         cache_covers(&acc_cache_t, rows, cols, d);
 }
 
+void acc_grow_cache(const uint16_t n, const uint16_t k, const uint16_t d) {
+  uint32_t rows = n + 1;
+  uint32_t cols = k;
+  if (acc_covers(rows, cols, d)) {
+    return;
+  }
+  if (!acc_covers(0, 0, d)) {
+    acc_free_cache();
+    acc_build_cache(n, k, d);
+    return;
+  }
+
+  uint32_t old_rows = acc_cache_t.rows;
+  uint32_t old_cols = acc_cache_t.cols;
+  resize_cache(&acc_cache_t, max(rows, old_rows), max(cols, old_cols));
+
+  region_t *outer = region_enter(&acc_cache_t.region);
+  if (cache_sums == PREFIX_SUMS) {
+    for (uint16_t row = 0; row < acc_cache_t.rows; ++row) {
+      uint16_t col = (row < old_rows) ? old_cols : 0;
+      for (; col < acc_cache_t.cols; ++col) {
+        prefix_fill(row, col, d);
+      }
+    }
+  } else if (acc_cache_t.state == NULL) {
+    for (uint16_t row = 0; row < acc_cache_t.rows; ++row) {
+      uint16_t col = (row < old_rows) ? old_cols : 0;
+      for (; col < acc_cache_t.cols; ++col) {
+        inner_acc(GET_CACHE_ACC(row, col), row, col, d);
+      }
+    }
+  }
+  region_leave(outer);
+
+  after_cache_build(&acc_cache_t, acc_cache_t.rows - 1, acc_cache_t.cols, d);
+}
+
+void grow_caches(const uint16_t n, const uint16_t k, const uint16_t d) {
+  for (uint8_t i = 1; i <= cache_type; ++i) {
+    cache_growers[i](n, k, d);
+  }
+  grow_tail(n, k, d);
+}
+
+void generic_free_cache(cache_t *cache) {
+  if (cache->is_static) {
+    cache->data = NULL;
+    return;
+  }
+  free(cache->band);
+  free(cache->state);
+  cache->band = NULL;
+  cache->state = NULL;
+  cache_dealloc(cache);
+  region_free(&cache->region);
+}
+
+void bin_free_cache() { generic_free_cache(&bin_cache_t); }
+
+void comb_free_cache() { generic_free_cache(&comb_cache_t); }
+
+void scomb_free_cache() {
+  if (scomb_cache_t.data == NULL) {
+    return;
+  }
+  for (uint16_t j = 0; j < scomb_cache_t.cols; ++j) {
+    free(GET_CACHE_SCOMB(0, j));
+  }
+  cache_dealloc(&scomb_cache_t);
+  region_free(&scomb_cache_t.region);
+}
+
+void acc_free_cache() { generic_free_cache(&acc_cache_t); }
+
 void free_caches() {
   for (uint8_t i = 1; i <= cache_type; ++i) {
     cache_demolishers[i]();
   }
+  free_tail();
 }
@@ -1,47 +1,66 @@
 #include "colex.h"
 #include "cache.h"
 #include "common.h"
+#include "kernels.h"
 #include "math.h"
+#include "tail.h"
 #include "utils.h"
 
-void colex_unrank(uint32_t *rop, const uint16_t n, const uint16_t k,
-                  const uint16_t d, const uintx r) {
+ALWAYS_INLINE void inner_colex_unrank(uint32_t *rop, const uint16_t n,
+                                      const uint16_t k, const uint16_t d,
+                                      uintx_cref r, workspace_t *ws) {
+  (void)ws;
   uint16_t it_n = n;
   uintx rank = r;
   uint16_t part = 0;
-  uintx count = 0;
+  uintx buffer = 0;
+  const uintx *count = NULL;
 
+  // the last part needs no count, as `r` is in range
   for (uint16_t i = k - 1; i > 0; rop[i] = part, --i, it_n -= part) {
-    for (part = 0; count = bic(it_n - part, i, d), rank >= count;
-         ++part, rank -= count) {
+    if (tail_covers(i, it_n, d)) {
+      tail_unrank(rop, tail_cache.colex, it_n, rank);
+      return;
+    }
+    for (part = 0;
+         part < min(it_n, d) &&
+         (count = bic_view(it_n - part, i, d, &buffer), rank >= *count);
+         ++part, rank -= *count) {
     }
+    // the next level scans from what is left, loading while this one ends
+    prefetch_bic(it_n - part, i - 1, d);
   }
 
   rop[0] = it_n;
 }
 
-void colex_unrank_part_sums(uint32_t *rop, const uint16_t n, const uint16_t k,
-                            const uint16_t d, const uintx r) {
+ALWAYS_INLINE void inner_colex_unrank_part_sums(uint32_t *rop, const uint16_t n,
+                                                const uint16_t k,
+                                                const uint16_t d, uintx_cref r,
+                                                workspace_t *ws) {
   uint16_t it_n = n;
   uintx rank = r;
   uint16_t part = 0;
 
-  uint16_t j = min(k - 1, it_n / (d + 1));
-  intx *prev_sum = (intx *)calloc(j + 1, sizeof(intx));
+  intx *prev_sum = ws->partial_sums;
 
   for (uint16_t i = k - 1; i > 0; rop[i] = part, --i, it_n -= part) {
+    if (tail_covers(i, it_n, d)) {
+      tail_unrank(rop, tail_cache.colex, it_n, rank);
+      return;
+    }
     intx left = 0;
-    intx right = inner_bic_with_sums(it_n, i, d, prev_sum, bin);
+    intx right = bic_with_sums_kernel(it_n, i, d, prev_sum, bin);
 
     for (part = 0; rank >= (uintx)right; ++part) {
       left = right;
       uint16_t numerator = (it_n - part);
       uint16_t denominator = (it_n - part) + i - 1;
 
-      j = min(i, (it_n - part - 1) / (d + 1));
+      uint16_t j = min(i, (it_n - part - 1) / (d + 1));
       for (uint16_t m = 0; m <= j; ++m) {
-        prev_sum[m] *= numerator;
-        prev_sum[m] /= denominator;
+        smul_word(&prev_sum[m], numerator);
+        sdivexact_word(&prev_sum[m], denominator);
         right += prev_sum[m];
         numerator -= (d + 1);
         denominator -= (d + 1);
@@ -52,85 +71,244 @@ void colex_unrank_part_sums(uint32_t *rop, const uint16_t n, const uint16_t k,
   }
 
   rop[0] = it_n;
-
-  free(prev_sum);
 }
 
-void colex_unrank_acc_linear(uint32_t *rop, const uint16_t n, const uint16_t k,
-                             const uint16_t d, const uintx r) {
+ALWAYS_INLINE void inner_colex_unrank_acc_linear(uint32_t *rop,
+                                                 const uint16_t n,
+                                                 const uint16_t k,
+                                                 const uint16_t d,
+                                                 uintx_cref r,
+                                                 workspace_t *ws) {
   uint16_t it_n = n;
   uintx rank = r;
   uint16_t part = 0;
   uintx count = 0;
 
   for (uint16_t i = k - 1; i > 0; rop[i] = part, --i, it_n -= part) {
-    uintx *sums = acc(it_n, i, d);
-    for (part = 0; count = sums[part + 1], rank >= count; ++part) {
+    if (tail_covers(i, it_n, d)) {
+      tail_unrank(rop, tail_cache.colex, it_n, rank);
+      return;
     }
-    rank -= sums[part];
-
-    if (cache_type < ACC_COMB_CACHE) {
-      free(sums);
+    // rank >= P(it_n, i) - P(it_n - part - 1, i) read straight from the
+    // prefix sums, with no row built and no difference taken per step
+    if (cache_type >= ACC_COMB_CACHE && cache_sums == PREFIX_SUMS) {
+      count = GET_CACHE_PREFIX(it_n, i) - rank;
+      for (part = 0; part < min(it_n, d) &&
+                     GET_CACHE_PREFIX(it_n - part - 1, i) >= count;
+           ++part) {
+      }
+      rank -= prefix_bic_acc(it_n, i, part);
+      continue;
+    }
+    uintx *sums = (cache_type >= ACC_COMB_CACHE)
+                      ? acc(it_n, i, d, ws->sums)
+                      : acc_kernel(ws->sums, it_n, i, d);
+    for (part = 0; part < min(it_n, d) &&
+                   (count = sums[part + 1], rank >= count);
+         ++part) {
     }
+    rank -= sums[part];
   }
 
   rop[0] = it_n;
 }
 
 void colex_unrank_acc_bisect(uint32_t *rop, const uint16_t n, const uint16_t k,
-                             const uint16_t d, const uintx r) {
+                             const uint16_t d, uintx_cref r, workspace_t *ws) {
   uint16_t it_n = n;
   uintx rank = r;
   uint16_t part = 0;
 
   for (uint16_t i = k - 1; i > 0; rop[i] = part, --i, it_n -= part) {
-    uintx *sums = acc(it_n, i, d);
+    if (tail_covers(i, it_n, d)) {
+      tail_unrank(rop, tail_cache.colex, it_n, rank);
+      return;
+    }
+    // as in `colex_unrank_acc_linear`, halving the parts left instead
+    if (cache_type >= ACC_COMB_CACHE && cache_sums == PREFIX_SUMS) {
+      const uintx count = GET_CACHE_PREFIX(it_n, i) - rank;
+      uint16_t hi = min(it_n, d);
+      for (part = 0; part < hi;) {
+        const uint16_t mid = (part + hi) / 2;
+        if (GET_CACHE_PREFIX(it_n - mid - 1, i) >= count) {
+          part = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      rank -= prefix_bic_acc(it_n, i, part);
+      continue;
+    }
+
+    uintx *sums = acc(it_n, i, d, ws->sums);
     size_t length = (size_t)sums[d + 2];
     part = bsearch_insertion(&rank, sums, length, sizeof(uintx));
     rank -= sums[part];
+  }
+
+  rop[0] = it_n;
+}
+
+void colex_unrank_acc_interp(uint32_t *rop, const uint16_t n, const uint16_t k,
+                             const uint16_t d, uintx_cref r, workspace_t *ws) {
+  uint16_t it_n = n;
+  uintx rank = r;
+  uint16_t part = 0;
+
+  for (uint16_t i = k - 1; i > 0; rop[i] = part, --i, it_n -= part) {
+    if (tail_covers(i, it_n, d)) {
+      tail_unrank(rop, tail_cache.colex, it_n, rank);
+      return;
+    }
 
-    if (cache_type < ACC_COMB_CACHE) {
-      free(sums);
+    uintx *sums = acc(it_n, i, d, ws->sums);
+    const uint16_t length = (uint16_t)sums[d + 2];
+
+    // the leading 53 bits of `rank` and of the row total place `rank` in the
+    // row as if it were linear, which the exact comparisons below then fix
+    const uint16_t bits = bit_length(sums[length]);
+    const uint16_t shift = (bits > 53) ? bits - 53 : 0;
+    const double target = (double)(uint64_t)(rank >> shift);
+    const double total = (double)(uint64_t)(sums[length] >> shift);
+    part = min((uint16_t)(target * length / total), length - 1);
+
+    for (; sums[part] > rank; --part) {
+    }
+    for (; sums[part + 1] <= rank; ++part) {
     }
+
+    rank -= sums[part];
   }
 
   rop[0] = it_n;
 }
 
 void colex_unrank_acc_direct(uint32_t *rop, const uint16_t n, const uint16_t k,
-                             const uint16_t d, const uintx r) {
+                             const uint16_t d, uintx_cref r, workspace_t *ws) {
+  (void)ws;
   uint16_t it_n = n;
   uintx rank = r;
   uint16_t part = 0;
-  uintx count = 0;
+  uintx buffer = 0;
 
   for (uint16_t i = k - 1; i > 0; rop[i] = part, --i, it_n -= part) {
+    if (tail_covers(i, it_n, d)) {
+      tail_unrank(rop, tail_cache.colex, it_n, rank);
+      return;
+    }
     part = 0;
     for (uint16_t c = min(it_n, d); c > 0;) {
       uint16_t step = (c / 2) + 1;
-      count = bic_acc(it_n, i, d, part + step);
-      if (rank >= count) {
+      if (rank >= *bic_acc_view(it_n, i, d, part + step, &buffer)) {
         part += step;
         c -= step;
       } else {
         c = step - 1;
       }
     }
-    rank -= bic_acc(it_n, i, d, part);
+    rank -= *bic_acc_view(it_n, i, d, part, &buffer);
   }
 
   rop[0] = it_n;
 }
 
+void colex_unrank(uint32_t *rop, const uint16_t n, const uint16_t k,
+                  const uint16_t d, uintx_cref r, workspace_t *ws) {
+  inner_colex_unrank(rop, n, k, d, r, ws);
+}
+
+void colex_unrank_part_sums(uint32_t *rop, const uint16_t n, const uint16_t k,
+                            const uint16_t d, uintx_cref r, workspace_t *ws) {
+  inner_colex_unrank_part_sums(rop, n, k, d, r, ws);
+}
+
+void colex_unrank_acc_linear(uint32_t *rop, const uint16_t n, const uint16_t k,
+                             const uint16_t d, uintx_cref r, workspace_t *ws) {
+  inner_colex_unrank_acc_linear(rop, n, k, d, r, ws);
+}
+
+DEFINE_SMALL_D_KERNELS(colex_unrank_small_d, inner_colex_unrank)
+DEFINE_SMALL_D_KERNELS(colex_unrank_part_sums_small_d,
+                       inner_colex_unrank_part_sums)
+DEFINE_SMALL_D_KERNELS(colex_unrank_acc_linear_small_d,
+                       inner_colex_unrank_acc_linear)
+
+uint32_t colex_next(part_iter_t *it) {
+  const uint16_t i = --it->remaining;
+  const uint16_t d = it->d;
+  uint16_t part = 0;
+  uintx buffer = 0;
+  const uintx *count = NULL;
+
+  if (i == 0) {
+    return it->it_n;
+  }
+
+  for (; part < min(it->it_n, d) &&
+         (count = bic_view(it->it_n - part, i, d, &buffer),
+          it->rank >= *count);
+       ++part, it->rank -= *count) {
+  }
+  it->it_n -= part;
+
+  return part;
+}
+
 uintx colex_rank(const uint16_t n, const uint16_t k, const uint16_t d,
                  const uint32_t *comb) {
+  if (cache_type == ACC_COMB_CACHE) {
+    return colex_rank_acc(n, k, d, comb);
+  }
+
   uintx rank = 0;
+  uintx buffer = 0;
   uint16_t it_n = n;
 
   for (uint16_t i = k - 1; i > 0; it_n -= comb[i], --i) {
-    for (uint16_t j = 0; j < comb[i]; rank += bic(it_n - j, i, d), ++j) {
+    for (uint16_t j = 0; j < comb[i]; ++j) {
+      rank += *bic_view(it_n - j, i, d, &buffer);
     }
   }
 
   return rank;
 }
+
+uintx colex_rank_acc(const uint16_t n, const uint16_t k, const uint16_t d,
+                     const uint32_t *comb) {
+  uintx rank = 0;
+  uintx buffer = 0;
+  uint16_t it_n = n;
+
+  for (uint16_t i = k - 1; i > 0; it_n -= comb[i], --i) {
+    rank += *bic_acc_view(it_n, i, d, comb[i], &buffer);
+  }
+
+  return rank;
+}
+
+void colex_advance(uint32_t *comb, const uint16_t n, const uint16_t k,
+                   const uint16_t d, uintx_cref delta, workspace_t *ws) {
+  uintx rank = 0;
+  uintx buffer = 0;
+  uint16_t it_n = comb[0];
+
+  // `rank` is that of `comb[0..i - 1]` among the compositions of `it_n` into
+  // `i` parts, which only depends on the low-order parts
+  for (uint16_t i = 1; i < k; ++i) {
+    const uintx *all = bic_view(it_n, i, d, &buffer);
+    if (delta < *all && rank + delta < *all) {
+      inner_colex_unrank(comb, it_n, i, d, rank + delta, ws);
+      return;
+    }
+
+    it_n += comb[i];
+    for (uint16_t j = 0; j < comb[i]; ++j) {
+      rank += *bic_view(it_n - j, i, d, &buffer);
+    }
+  }
+
+  // the caches stop short of `k` parts, and the delta may wrap around
+  const uintx all = inner_bic_with_sums(n, k, d, NULL, pascal);
+  const uintx r = rank + ((delta < all) ? delta : delta % all);
+  inner_colex_unrank(comb, n, k, d, (r < all) ? r : r - all, ws);
+}
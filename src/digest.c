@@ -0,0 +1,109 @@
+#include "digest.h"
+#include "math.h"
+
+#include <assert.h>
+#include <string.h>
+
+uintx import_rank(const uint8_t *bytes, const size_t length) {
+  assert(8 * length <= BIT_LENGTH);
+  uintx rank = 0;
+
+#if defined(BITINT)
+  unsigned char *ptr = (unsigned char *)&rank;
+  for (size_t i = 0; i < length; ++i) {
+    ptr[length - 1 - i] = bytes[i];
+  }
+#elif defined(BOOST_FIX_INT) || defined(BOOST_UINT_INT) ||                   \
+    defined(BOOST_ARB_INT)
+  boost::multiprecision::import_bits(rank, bytes, bytes + length, 8);
+#elif defined(BOOST_MPZ_INT)
+  mpz_import(rank.backend().data(), length, 1, sizeof(uint8_t), 0, 0, bytes);
+#elif defined(BOOST_TOM_INT)
+  mp_err err = mp_unpack(&rank.backend().data(), length, 1, sizeof(uint8_t), 0,
+                         0, bytes);
+  (void)err;
+#endif
+
+  return rank;
+}
+
+void export_rank(uint8_t *rop, const size_t length, uintx_cref r) {
+  size_t used = (bit_length(r) + 7) / 8;
+  assert(used <= length);
+  memset(rop, 0, length - used);
+  if (used == 0) {
+    return;
+  }
+
+#if defined(BITINT)
+  const unsigned char *ptr = (const unsigned char *)&r;
+  for (size_t i = 0; i < used; ++i) {
+    rop[length - 1 - i] = ptr[i];
+  }
+#elif defined(BOOST_FIX_INT) || defined(BOOST_UINT_INT) ||                   \
+    defined(BOOST_ARB_INT)
+  boost::multiprecision::export_bits(r, rop + length - used, 8);
+#elif defined(BOOST_MPZ_INT)
+  mpz_export(rop + length - used, NULL, 1, sizeof(uint8_t), 0, 0,
+             r.backend().data());
+#elif defined(BOOST_TOM_INT)
+  mp_err err = mp_pack(rop + length - used, used, NULL, 1, sizeof(uint8_t), 0,
+                       0, &r.backend().data());
+  (void)err;
+#endif
+}
+
+void setup_modulus(workspace_t *ws, const uint16_t n, const uint16_t k,
+                   const uint16_t d) {
+  ws->modulus = inner_bic_with_sums(n, k, d, NULL, pascal);
+  ws->modulus_bits = bit_length(ws->modulus);
+  ws->reciprocal = 0;
+  ws->reciprocal_length = 0;
+}
+
+uintx reduce_rank(const uint8_t *bytes, const size_t length, workspace_t *ws) {
+  uintx x = import_rank(bytes, length);
+  const uint16_t b = ws->modulus_bits;
+  const uint16_t l = 8 * length;
+
+  // below 2^(b - 1), which the modulus is not
+  if (l < b) {
+    return x;
+  }
+
+  // the quotient by Barrett takes 2 (l - b + 1) bits, which a fixed width may
+  // not have for a short modulus and a long digest
+  if (2 * (l - b + 1) > BIT_LENGTH) {
+    return x % ws->modulus;
+  }
+
+  // floor((2^l - 1) / modulus), one less than the usual floor(2^l / modulus)
+  // only for a power of two, which the corrections below absorb
+  if (ws->reciprocal_length != length) {
+    const uintx top = (uintx)1 << (l - 1);
+    ws->reciprocal = (top - 1 + top) / ws->modulus;
+    ws->reciprocal_length = length;
+  }
+
+  // HAC 14.42, with the estimate off by at most three
+  const uintx q = ((x >> (b - 1)) * ws->reciprocal) >> (l - b + 1);
+  x -= q * ws->modulus;
+  while (x >= ws->modulus) {
+    x -= ws->modulus;
+  }
+
+  return x;
+}
+
+void unrank_from_bytes(const order *ord, uint32_t *rop, const uint16_t n,
+                       const uint16_t k, const uint16_t d,
+                       const uint8_t *digest, const size_t length,
+                       workspace_t *ws) {
+  (*ord->unrank)(rop, n, k, d, reduce_rank(digest, length, ws), ws);
+}
+
+void rank_to_bytes(const order *ord, uint8_t *rop, const size_t length,
+                   const uint16_t n, const uint16_t k, const uint16_t d,
+                   const uint32_t *comb) {
+  export_rank(rop, length, (*ord->rank)(n, k, d, comb));
+}
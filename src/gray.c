@@ -1,44 +1,112 @@
 #include "gray.h"
+#include "cache.h"
+#include "kernels.h"
 #include "math.h"
+#include "tail.h"
 #include "utils.h"
 
-void gray_unrank(uint32_t *rop, const uint16_t n, const uint16_t k,
-                 const uint16_t d, const uintx r) {
+ALWAYS_INLINE void inner_gray_unrank(uint32_t *rop, const uint16_t n,
+                                     const uint16_t k, const uint16_t d,
+                                     uintx_cref r, workspace_t *ws) {
+  (void)ws;
   uint16_t it_n = n;
   uintx rank = r;
   uint16_t part = 0;
-  uintx count = 0;
+  uintx buffer = 0;
+  const uintx *count = NULL;
 
   for (uint16_t i = k - 1; i > 0; rop[i] = part, --i, it_n -= part) {
-    for (part = 0; count = bic(it_n - part, i, d), rank >= count;
-         ++part, rank -= count) {
+    if (tail_covers(i, it_n, d)) {
+      tail_unrank(rop, tail_cache.gray, it_n, rank);
+      return;
+    }
+    for (part = 0; count = bic_view(it_n - part, i, d, &buffer), rank >= *count;
+         ++part, rank -= *count) {
     }
     if (part & 1U) {
-      rank = count - 1 - rank;
+      rank = *count - 1 - rank;
     }
+    // the next level scans from what is left, loading while this one ends
+    prefetch_bic(it_n - part, i - 1, d);
   }
 
   rop[0] = it_n;
 }
 
+void gray_unrank(uint32_t *rop, const uint16_t n, const uint16_t k,
+                 const uint16_t d, uintx_cref r, workspace_t *ws) {
+  inner_gray_unrank(rop, n, k, d, r, ws);
+}
+
+DEFINE_SMALL_D_KERNELS(gray_unrank_small_d, inner_gray_unrank)
+
+uint32_t gray_next(part_iter_t *it) {
+  const uint16_t i = --it->remaining;
+  const uint16_t d = it->d;
+  uint16_t part = 0;
+  uintx buffer = 0;
+  const uintx *count = NULL;
+
+  if (i == 0) {
+    return it->it_n;
+  }
+
+  for (; count = bic_view(it->it_n - part, i, d, &buffer),
+         it->rank >= *count;
+       ++part, it->rank -= *count) {
+  }
+  if (part & 1U) {
+    it->rank = *count - 1 - it->rank;
+  }
+  it->it_n -= part;
+
+  return part;
+}
+
 uintx gray_rank(const uint16_t n, const uint16_t k, const uint16_t d,
                 const uint32_t *comb) {
+  if (cache_type == ACC_COMB_CACHE) {
+    return gray_rank_acc(n, k, d, comb);
+  }
+
   uint16_t it_n = n;
   uintx rank = 0;
+  uintx buffer = 0;
   uint16_t part = 0;
 
   for (uint16_t i = k - 1, p = n & 1U, parity = 0;
        part = comb[i], parity = it_n & 1U, i > 0; --i, it_n -= part) {
     if (parity == p) {
       for (uint16_t j = 0; j < part; ++j) {
-        rank += bic(it_n - j, i, d);
+        rank += *bic_view(it_n - j, i, d, &buffer);
       }
     } else {
       for (uint16_t j = part + 1; j < min(it_n, d) + 1; ++j) {
-        rank += bic(it_n - j, i, d);
+        rank += *bic_view(it_n - j, i, d, &buffer);
       }
     }
   }
 
   return rank;
 }
+
+uintx gray_rank_acc(const uint16_t n, const uint16_t k, const uint16_t d,
+                    const uint32_t *comb) {
+  uint16_t it_n = n;
+  uintx rank = 0;
+  uintx buffer = 0;
+  uintx below = 0;
+  uint16_t part = 0;
+
+  for (uint16_t i = k - 1, p = n & 1U, parity = 0;
+       part = comb[i], parity = it_n & 1U, i > 0; --i, it_n -= part) {
+    if (parity == p) {
+      rank += *bic_acc_view(it_n, i, d, part, &buffer);
+    } else {
+      rank += *bic_acc_view(it_n, i, d, min(it_n, d) + 1, &buffer) -
+              *bic_acc_view(it_n, i, d, part + 1, &below);
+    }
+  }
+
+  return rank;
+}
@@ -0,0 +1,33 @@
+#include "kernels.h"
+#include "colex.h"
+#include "gray.h"
+
+int kernel_mode = SMALL_D_KERNELS;
+
+typedef struct {
+  unrank_func generic;
+  const unrank_func *small_d;
+} specialization_t;
+
+static const specialization_t specializations[] = {
+    {colex_unrank, colex_unrank_small_d},
+    {colex_unrank_part_sums, colex_unrank_part_sums_small_d},
+    {colex_unrank_acc_linear, colex_unrank_acc_linear_small_d},
+    {gray_unrank, gray_unrank_small_d},
+};
+
+order specialize_order(order ord, const uint16_t d) {
+  if (kernel_mode == GENERIC_KERNELS || d == 0 || d > SMALL_D_MAX) {
+    return ord;
+  }
+
+  size_t length = sizeof(specializations) / sizeof(specialization_t);
+  for (size_t i = 0; i < length; ++i) {
+    if (ord.unrank == specializations[i].generic) {
+      ord.unrank = specializations[i].small_d[d];
+      break;
+    }
+  }
+
+  return ord;
+}
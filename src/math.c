@@ -1,9 +1,137 @@
 #include "math.h"
 #include "cache.h"
+#include "digest.h"
 #include "utils.h"
 
+#include <string.h>
+
+#if defined(BITINT) && (BITINT % 64 == 0)
+typedef unsigned _BitInt(128) dlimb_t;
+
+#define LIMBS (sizeof(uintx) / sizeof(uint64_t))
+
+void mul_word(uintx *rop, const uint64_t w) {
+  uint64_t limbs[LIMBS];
+  memcpy(limbs, rop, sizeof(uintx));
+
+  dlimb_t carry = 0;
+  for (size_t i = 0; i < LIMBS; ++i) {
+    carry += (dlimb_t)limbs[i] * w;
+    limbs[i] = (uint64_t)carry;
+    carry >>= 64;
+  }
+
+  memcpy(rop, limbs, sizeof(uintx));
+}
+
+// mpn_divexact_1 from GMP: Hensel division by the odd part of `w`
+void divexact_word(uintx *rop, const uint64_t w) {
+  uint64_t limbs[LIMBS];
+  memcpy(limbs, rop, sizeof(uintx));
+
+  uint8_t shift = __builtin_ctzll(w);
+  uint64_t odd = w >> shift;
+  if (shift > 0) {
+    for (size_t i = 0; i + 1 < LIMBS; ++i) {
+      limbs[i] = (limbs[i] >> shift) | (limbs[i + 1] << (64 - shift));
+    }
+    limbs[LIMBS - 1] >>= shift;
+  }
+
+  // Newton iteration for the inverse modulo 2^64, starting from 3 bits
+  uint64_t inverse = odd;
+  for (uint8_t i = 0; i < 5; ++i) {
+    inverse *= 2 - odd * inverse;
+  }
+
+  uint64_t borrow = 0;
+  for (size_t i = 0; i < LIMBS; ++i) {
+    uint64_t s = limbs[i];
+    uint64_t x = s - borrow;
+    borrow = x > s;
+    limbs[i] = x * inverse;
+    borrow += (uint64_t)(((dlimb_t)limbs[i] * odd) >> 64);
+  }
+
+  memcpy(rop, limbs, sizeof(uintx));
+}
+
+void smul_word(intx *rop, const uint64_t w) {
+  uintx u = (uintx)*rop;
+  mul_word(&u, w);
+  *rop = (intx)u;
+}
+
+void sdivexact_word(intx *rop, const uint64_t w) {
+  bool negative = *rop < 0;
+  uintx u = negative ? -(uintx)*rop : (uintx)*rop;
+  divexact_word(&u, w);
+  *rop = negative ? -(intx)u : (intx)u;
+}
+#elif defined(BITINT)
+void mul_word(uintx *rop, const uint64_t w) { *rop *= w; }
+
+void divexact_word(uintx *rop, const uint64_t w) { *rop /= w; }
+
+void smul_word(intx *rop, const uint64_t w) { *rop *= w; }
+
+void sdivexact_word(intx *rop, const uint64_t w) { *rop /= (intx)w; }
+#elif defined(BOOST_MPZ_INT)
+void mul_word(uintx *rop, const uint64_t w) {
+  mpz_mul_ui(rop->backend().data(), rop->backend().data(), w);
+}
+
+void divexact_word(uintx *rop, const uint64_t w) {
+  mpz_divexact_ui(rop->backend().data(), rop->backend().data(), w);
+}
+
+void smul_word(intx *rop, const uint64_t w) { mul_word(rop, w); }
+
+void sdivexact_word(intx *rop, const uint64_t w) { divexact_word(rop, w); }
+#elif defined(BOOST_TOM_INT)
+void mul_word(uintx *rop, const uint64_t w) {
+  mp_err err = mp_mul_d(&rop->backend().data(), w, &rop->backend().data());
+  (void)err;
+}
+
+void divexact_word(uintx *rop, const uint64_t w) {
+  mp_err err =
+      mp_div_d(&rop->backend().data(), w, &rop->backend().data(), NULL);
+  (void)err;
+}
+
+void smul_word(intx *rop, const uint64_t w) { mul_word(rop, w); }
+
+void sdivexact_word(intx *rop, const uint64_t w) { divexact_word(rop, w); }
+#else
+// cpp_int takes the single-limb paths when the operand is a limb_type
+void mul_word(uintx *rop, const uint64_t w) {
+  *rop *= (boost::multiprecision::limb_type)w;
+}
+
+void divexact_word(uintx *rop, const uint64_t w) {
+  *rop /= (boost::multiprecision::limb_type)w;
+}
+
+void smul_word(intx *rop, const uint64_t w) {
+  *rop *= (boost::multiprecision::limb_type)w;
+}
+
+void sdivexact_word(intx *rop, const uint64_t w) {
+  *rop /= (boost::multiprecision::limb_type)w;
+}
+#endif
+
+void smul_bin(intx *rop, uintx_cref b) {
+  if (b <= WORD_MAX) {
+    smul_word(rop, (uint64_t)b);
+  } else {
+    *rop *= (intx)b;
+  }
+}
+
 #if defined(BITINT)
-long double lg(const uintx u) {
+long double lg(uintx_cref u) {
   // actually a truncated logarithm
   if (u == 0) {
     return -1.0;
@@ -15,14 +143,41 @@ long double lg(const uintx u) {
   }
   return 0;
 }
+
+uint16_t bit_length(uintx_cref u) {
+  for (uint16_t j = (BITINT + 63) / 64; j > 0; --j) {
+    uint64_t limb = (uint64_t)(u >> (64 * (j - 1)));
+    if (limb != 0) {
+      return 64 * j - __builtin_clzll(limb);
+    }
+  }
+  return 0;
+}
 #else
-long double lg(const uintx u) {
+long double lg(uintx_cref u) {
   return (long double)log2(boost::multiprecision::cpp_bin_float_100(u));
 }
+
+uint16_t bit_length(uintx_cref u) {
+  return (u == 0) ? 0 : boost::multiprecision::msb(u) + 1;
+}
 #endif
 
 uint16_t bits_fit_bic(const uint16_t n, const uint16_t k, const uint16_t d) {
-  return 1 + ((uint16_t)lg(inner_bic_with_sums(n, k, d, NULL, inner_bin)));
+  return 1 + ((uint16_t)lg(inner_bic_with_sums(n, k, d, NULL, pascal)));
+}
+
+uint16_t bits_fit_terms(const uint16_t n, const uint16_t k, const uint16_t d) {
+  // `bic_acc` multiplies C(k, i) by C(n - (d + 1) * i + k, k), which bounds
+  // the terms of `inner_bic_with_sums`, and `inner_bin` multiplies its running
+  // product by a word below 2^16 before dividing
+  uint16_t bits = 0;
+  uint16_t j = min(k, n / (d + 1));
+  for (uint16_t i = 0; i <= j; ++i) {
+    bits = max(bits, bit_length(inner_bin(k, i, d)) +
+                         bit_length(inner_bin(n - (d + 1) * i + k, k, d)));
+  }
+  return 1 + bits + 16;
 }
 
 double asqrt(double x) {
@@ -59,49 +214,46 @@ uintx inner_bin(const uint16_t n, const uint16_t k, const uint16_t d) {
     kk = n - k;
   }
 
-  uintx b = n - kk + 1;
-  uintx f = b;
+  uint16_t f = n - kk + 1;
+  uintx b = f;
 
-  for (uintx j = 2; j <= kk; ++j) {
+  for (uint16_t j = 2; j <= kk; ++j) {
     ++f;
-    b *= f;
-    b /= j;
+    mul_word(&b, f);
+    divexact_word(&b, j);
   }
 
   return b;
 }
 
-uintx bin(const uint16_t n, const uint16_t k, const uint16_t d) {
-  GET_CACHE_OR_CALC(BIN_CACHE, GET_CACHE_BIN(n, k), inner_bin);
+const uintx *bin(const uint16_t n, const uint16_t k, const uint16_t d,
+                 uintx *buffer) {
+  if (cache_type >= BIN_CACHE) {
+    return &GET_CACHE_BIN(n, k);
+  }
+  *buffer = inner_bin(n, k, d);
+  return buffer;
 }
 
-uintx inner_bic_with_sums(const uint16_t n, const uint16_t k, const uint16_t d,
-                          intx *partial_sums, math_func bin_impl) {
-  if (n == 0) {
-    return 1;
+// views of replaced tables stay valid, see pascal_grow_cache
+const uintx *pascal(const uint16_t n, const uint16_t k, const uint16_t d,
+                    uintx *buffer) {
+  (void)d;
+  if (k > n) {
+    *buffer = 0;
+    return buffer;
   }
 
-  intx rop = 0;
-  intx inner = 0;
-  uintx left = 0;
-  uintx right = 0;
-
-  uint16_t j = min(k, n / (d + 1));
-  for (uint16_t i = 0; i <= j; ++i) {
-    left = bin_impl(k, i, d);
-    right = bin_impl(n - (d + 1) * i + k - 1, k - 1, d);
-    inner = left * right;
-    if (i & 1U) {
-      inner = -inner;
-    }
-    rop += inner;
-
-    if (partial_sums != NULL) {
-      partial_sums[i] = inner;
-    }
+  uint16_t kk = min(k, n - k);
+  if (kk >= pascal_cache_t.cols || n > pascal_cache_t.band[kk].hi) {
+    pascal_grow_cache(n + 1, kk + 1);
   }
+  return &GET_CACHE_PASCAL(n, kk);
+}
 
-  return (uintx)rop;
+uintx inner_bic_with_sums(const uint16_t n, const uint16_t k, const uint16_t d,
+                          intx *partial_sums, math_func bin_impl) {
+  return bic_with_sums_kernel(n, k, d, partial_sums, bin_impl);
 }
 
 uintx inner_bic(const uint16_t n, const uint16_t k, const uint16_t d) {
@@ -109,45 +261,91 @@ uintx inner_bic(const uint16_t n, const uint16_t k, const uint16_t d) {
 }
 
 uintx bic(const uint16_t n, const uint16_t k, const uint16_t d) {
+  uintx buffer = 0;
+  const uintx *view = bic_view(n, k, d, &buffer);
+  if (view == &buffer) {
+    return buffer;
+  }
+  return *view;
+}
+
+const uintx *bic_view(const uint16_t n, const uint16_t k, const uint16_t d,
+                      uintx *buffer) {
   if (cache_type == SMALL_COMB_CACHE) {
     uintx *row = GET_CACHE_SCOMB(0, k - 1);
     uint16_t left = (uint16_t)row[0];
     uint16_t right = (uint16_t)row[1];
 
-    if (n < left || n > right) {
-      return inner_bic(n, k, d);
+    if (n >= left && n <= right) {
+      return &row[n - left + 2];
+    }
+  } else if (cache_type >= COMB_CACHE &&
+             !cache_contains(&comb_cache_t, n, k)) {
+    if (n > k * d) {
+      *buffer = 0;
+      return buffer;
     }
-    return row[n - left + 2];
+  } else if (cache_type >= COMB_CACHE && comb_cache_t.state != NULL) {
+    return lazy_comb(n, k, d, buffer);
+  } else if (cache_type >= COMB_CACHE) {
+    return &GET_CACHE_COMB(n, k);
   }
 
-  GET_CACHE_OR_CALC(COMB_CACHE, GET_CACHE_COMB(n, k), inner_bic);
+  *buffer = inner_bic(n, k, d);
+  return buffer;
 }
 
-uintx *inner_acc(const uint16_t n, const uint16_t k, const uint16_t d) {
-  size_t length = d + 3;
-  size_t i = 0;
-  uintx *rop = (uintx *)calloc(length, sizeof(uintx));
-  acc_cache_t.total_size += length * sizeof(uintx);
-  uintx sum = 0;
+static const uint16_t PREFETCH_CELLS = 8;
 
-  rop[0] = 0;
-  for (; i <= min(n, d); ++i) {
-    sum += bic(n - i, k, d);
-    rop[i + 1] = sum;
+void prefetch_bic(const uint16_t n, const uint16_t k, const uint16_t d) {
+  if (cache_type < COMB_CACHE || cache_type == SMALL_COMB_CACHE || k == 0) {
+    return;
+  }
+
+  for (uint16_t p = 0; p <= min(min(n, d), PREFETCH_CELLS - 1); ++p) {
+    if (cache_contains(&comb_cache_t, n - p, k)) {
+      __builtin_prefetch(cache_get_element(&comb_cache_t, n - p, k));
+    }
   }
-  rop[length - 1] = i;
+}
 
-  return rop;
+uintx *inner_acc(uintx *rop, const uint16_t n, const uint16_t k,
+                 const uint16_t d) {
+  return acc_kernel(rop, n, k, d);
 }
 
-uintx *acc(const uint16_t n, const uint16_t k, const uint16_t d) {
-  GET_CACHE_OR_CALC(ACC_COMB_CACHE, GET_CACHE_ACC(n, k), inner_acc);
+uintx *acc(const uint16_t n, const uint16_t k, const uint16_t d,
+           uintx *buffer) {
+  if (cache_type >= ACC_COMB_CACHE) {
+    if (cache_sums == PREFIX_SUMS) {
+      return prefix_acc(n, k, d, buffer);
+    }
+    if (acc_cache_t.state != NULL) {
+      return lazy_acc(n, k, d, buffer);
+    }
+    return GET_CACHE_ACC(n, k);
+  }
+  return inner_acc(buffer, n, k, d);
 }
 
 uintx bic_acc(const uint16_t n, const uint16_t k, const uint16_t d,
               const uint16_t l) {
+  uintx buffer = 0;
+  const uintx *view = bic_acc_view(n, k, d, l, &buffer);
+  if (view == &buffer) {
+    return buffer;
+  }
+  return *view;
+}
+
+const uintx *bic_acc_view(const uint16_t n, const uint16_t k, const uint16_t d,
+                          const uint16_t l, uintx *buffer) {
+  if (cache_type == ACC_COMB_CACHE && cache_sums == ROW_SUMS) {
+    return &acc(n, k, d, NULL)[l];
+  }
   if (cache_type == ACC_COMB_CACHE) {
-    return acc(n, k, d)[l];
+    *buffer = prefix_bic_acc(n, k, l);
+    return buffer;
   }
 
   uint16_t j = min(k, n / (d + 1));
@@ -155,44 +353,33 @@ uintx bic_acc(const uint16_t n, const uint16_t k, const uint16_t d,
 
   intx tmp = 0;
   intx rop = 0;
+  uintx top = 0;
+  uintx bottom = 0;
 
   for (uint16_t i = 0; i <= j; ++i) {
     u = n - (d + 1) * i + k;
-    tmp = bin(k, i, d) * (bin(u, k, d) - bin(max(0, u - l), k, d));
+    tmp = (intx)(*bin(u, k, d, &top) - *bin(max(0, u - l), k, d, &bottom));
+    smul_bin(&tmp, *bin(k, i, d, &top));
     if (i & 1U) {
       tmp = -tmp;
     }
     rop += tmp;
   }
 
-  return (uintx)rop;
+  *buffer = (uintx)rop;
+  return buffer;
 }
 
-uintx random_rank(const uint16_t n, const uint16_t k, const uint16_t d) {
-  uint16_t len = bits_fit_bic(n, k, d) / sizeof(uint64_t);
-  len += (len == 0);
-
-  uint8_t *message = (uint8_t *)calloc(len, sizeof(uint8_t));
+uintx random_rank(const uint16_t n, const uint16_t k, const uint16_t d,
+                  workspace_t *ws) {
+  // the workspace was set up for (n, k, d) and holds their modulus
+  (void)n;
+  (void)k;
+  (void)d;
+  uint16_t len = ws->bytes_length;
+  uint8_t *message = ws->bytes;
   for (uint16_t i = 0; i < len; ++i) {
     message[i] = random();
   }
-  uintx rank = 0;
-
-#if defined(BITINT)
-  unsigned char *ptr = (unsigned char *)&rank;
-  for (uint16_t i = 0; i < len; ++i) {
-    ptr[len - 1 - i] = message[i];
-  }
-#elif defined(BOOST_FIX_INT) || defined(BOOST_ARB_INT)
-  boost::multiprecision::detail::import_bits_fast(rank, message, message + len);
-#elif defined(BOOST_MPZ_INT)
-  mpz_import(rank.backend().data(), len, 1, sizeof(uint8_t), 0, 0, message);
-#elif defined(BOOST_TOM_INT)
-  mp_err err =
-      mp_unpack(&rank.backend().data(), len, 1, sizeof(uint8_t), 0, 0, message);
-  (void)err;
-#endif
-
-  free(message);
-  return rank % inner_bic(n, k, d);
+  return reduce_rank(message, len, ws);
 }
@@ -0,0 +1,126 @@
+#include "pack.h"
+
+#include <assert.h>
+
+uint8_t select_format(const uint16_t d) {
+  return (d <= UINT8_MAX) ? U8_FORMAT : U16_FORMAT;
+}
+
+uint8_t part_bits(const uint16_t d, const uint8_t format) {
+  switch (format) {
+  case U16_FORMAT:
+    return 16;
+  case U8_FORMAT:
+    return 8;
+  case BIT_FORMAT: {
+    uint8_t bits = 1;
+    for (; (d >> bits) > 0; ++bits) {
+    }
+    return bits;
+  }
+  default:
+    return 32;
+  }
+}
+
+size_t packed_size(const uint16_t k, const uint16_t d, const uint8_t format) {
+  return ((size_t)k * part_bits(d, format) + 7) / 8;
+}
+
+uint32_t get_part(const void *comb, const uint16_t i, const uint8_t bits) {
+  switch (bits) {
+  case 32:
+    return ((const uint32_t *)comb)[i];
+  case 16:
+    return ((const uint16_t *)comb)[i];
+  case 8:
+    return ((const uint8_t *)comb)[i];
+  }
+
+  // parts are at most 16 bits wide, so they span at most three bytes
+  size_t bit = (size_t)i * bits;
+  const uint8_t *bytes = (const uint8_t *)comb + bit / 8;
+  uint8_t shift = bit % 8;
+  uint32_t window = 0;
+  for (uint8_t j = 0; 8 * j < shift + bits; ++j) {
+    window |= (uint32_t)bytes[j] << (8 * j);
+  }
+  return (window >> shift) & ((1U << bits) - 1);
+}
+
+void set_part(void *comb, const uint16_t i, const uint8_t bits,
+              const uint32_t part) {
+  switch (bits) {
+  case 32:
+    ((uint32_t *)comb)[i] = part;
+    return;
+  case 16:
+    ((uint16_t *)comb)[i] = part;
+    return;
+  case 8:
+    ((uint8_t *)comb)[i] = part;
+    return;
+  }
+
+  size_t bit = (size_t)i * bits;
+  uint8_t *bytes = (uint8_t *)comb + bit / 8;
+  uint8_t shift = bit % 8;
+  uint32_t mask = ((1U << bits) - 1) << shift;
+  uint32_t value = part << shift;
+  for (uint8_t j = 0; 8 * j < shift + bits; ++j) {
+    uint8_t m = mask >> (8 * j);
+    bytes[j] = (bytes[j] & ~m) | ((value >> (8 * j)) & m);
+  }
+}
+
+void pack_composition(void *rop, const uint32_t *comb, const uint16_t k,
+                      const uint16_t d, const uint8_t format) {
+  uint8_t bits = part_bits(d, format);
+  for (uint16_t i = 0; i < k; ++i) {
+    set_part(rop, i, bits, comb[i]);
+  }
+}
+
+void unpack_composition(uint32_t *rop, const void *comb, const uint16_t k,
+                        const uint16_t d, const uint8_t format) {
+  uint8_t bits = part_bits(d, format);
+  for (uint16_t i = 0; i < k; ++i) {
+    rop[i] = get_part(comb, i, bits);
+  }
+}
+
+void packed_unrank(const order *ord, void *rop, const uint16_t n,
+                   const uint16_t k, const uint16_t d, uintx_cref r,
+                   const uint8_t format, workspace_t *ws) {
+  if (format == U32_FORMAT) {
+    (*ord->unrank)((uint32_t *)rop, n, k, d, r, ws);
+    return;
+  }
+
+  (*ord->unrank)(ws->parts, n, k, d, r, ws);
+  pack_composition(rop, ws->parts, k, d, format);
+}
+
+uintx packed_rank(const order *ord, const void *comb, const uint16_t n,
+                  const uint16_t k, const uint16_t d, const uint8_t format,
+                  workspace_t *ws) {
+  if (format == U32_FORMAT) {
+    return (*ord->rank)(n, k, d, (const uint32_t *)comb);
+  }
+
+  unpack_composition(ws->parts, comb, k, d, format);
+  return (*ord->rank)(n, k, d, ws->parts);
+}
+
+void check_valid_packed_composition(const void *c, const uint16_t n,
+                                    const uint16_t k, const uint16_t d,
+                                    const uint8_t format) {
+  uint8_t bits = part_bits(d, format);
+  uint32_t sum = 0;
+  for (uint16_t i = 0; i < k; ++i) {
+    uint32_t part = get_part(c, i, bits);
+    assert(part <= d);
+    sum += part;
+  }
+  assert(sum == n);
+}
@@ -0,0 +1,54 @@
+#include "paramset.h"
+#include "cache.h"
+#include "tail.h"
+
+#include <string.h>
+
+#if defined(__cplusplus)
+#define TABLE static constexpr
+#else
+#define TABLE static const
+#endif
+
+#define LIMB(hi, lo) (((uintx)(hi) << 64) | (uintx)(lo))
+
+#if __has_include("paramsets.inc")
+#include "paramsets.inc"
+#endif
+
+#if !defined(PARAMSETS_AVAILABLE)
+const paramset_t PARAMSETS[] = {
+    {NULL, 0, 0, 0, NULL, NULL, NULL},
+};
+#endif
+
+const paramset_t *find_paramset(const char *name) {
+  for (const paramset_t *set = PARAMSETS; set->name != NULL; ++set) {
+    if (strcmp(set->name, name) == 0) {
+      return set;
+    }
+  }
+  return NULL;
+}
+
+void load_caches(const paramset_t *set) {
+  const uint16_t n = set->n;
+  const uint16_t k = set->k;
+  const uint16_t d = set->d;
+
+  for (uint8_t i = 1; i <= cache_type; ++i) {
+    if (i == BIN_CACHE) {
+      static_setup_cache(&bin_cache_t, set->bin, n + k + 1, k, sizeof(uintx),
+                         (char *)"bin", BIN_CACHE);
+    } else if (i == COMB_CACHE && cache_layout == ROW_MAJOR_LAYOUT) {
+      static_setup_cache(&comb_cache_t, set->comb, n + 1, k + 1,
+                         sizeof(uintx), (char *)"comb", COMB_CACHE);
+    } else if (i == ACC_COMB_CACHE && cache_sums == ROW_SUMS) {
+      static_setup_cache(&acc_cache_t, set->acc, n + 1, k, sizeof(uintx *),
+                         (char *)"acc", ACC_COMB_CACHE);
+    } else {
+      cache_builders[i](n, k, d);
+    }
+  }
+  build_tail(n, k, d);
+}
@@ -0,0 +1,245 @@
+#include "pool.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(BOOST_MPZ_INT)
+#include <gmp.h>
+#endif
+
+int alloc_mode = POOL_ALLOC;
+size_t system_allocations = 0;
+
+// blocks of 32 bytes up to 4 KiB, header included, past which the system
+// allocator is about as fast
+#define POOL_CLASSES 8
+static const uint32_t MIN_BLOCK_SHIFT = 5;
+
+// free blocks kept per class and thread, the rest going back to the system
+static const uint32_t MAX_FREE_BLOCKS = 256;
+
+// regions grow by chunks of this many bytes, and blocks above a quarter of
+// it take a chunk of their own
+static const size_t REGION_CHUNK_SIZE = 64 * 1024;
+
+// in front of every block, so that any of them can be freed alone; 16 bytes,
+// which keeps the blocks as aligned as malloc does
+typedef struct {
+  region_t *region;
+  uint32_t size;
+  // POOL_CLASSES for the blocks that are not from the free lists
+  uint32_t pool;
+} block_t;
+
+typedef struct chunk_t {
+  struct chunk_t *next;
+  size_t used;
+  size_t size;
+} chunk_t;
+
+#define CHUNK_HEADER ((sizeof(chunk_t) + 15) & ~(size_t)15)
+
+static __thread void *free_lists[POOL_CLASSES];
+static __thread uint32_t free_counts[POOL_CLASSES];
+static __thread region_t *current_region;
+static __thread bool registered;
+
+static pthread_key_t release_key;
+static pthread_once_t release_once = PTHREAD_ONCE_INIT;
+
+static void *system_alloc(const size_t size) {
+  __atomic_fetch_add(&system_allocations, 1, __ATOMIC_RELAXED);
+  void *ptr = malloc(size);
+  assert(ptr != NULL);
+  return ptr;
+}
+
+static uint32_t pool_class(const size_t total) {
+  if (total <= ((size_t)1 << MIN_BLOCK_SHIFT)) {
+    return 0;
+  }
+  return 64 - __builtin_clzll(total - 1) - MIN_BLOCK_SHIFT;
+}
+
+static void release_thread(void *unused) {
+  (void)unused;
+  pool_release();
+}
+
+// the main thread never runs the destructor of `release_key`
+static void make_release_key(void) {
+  pthread_key_create(&release_key, release_thread);
+  atexit(pool_release);
+}
+
+static void lock_region(region_t *region) {
+  while (__atomic_test_and_set(&region->lock, __ATOMIC_ACQUIRE)) {
+  }
+}
+
+static void unlock_region(region_t *region) {
+  __atomic_clear(&region->lock, __ATOMIC_RELEASE);
+}
+
+static block_t *region_block(region_t *region, size_t total) {
+  total = (total + 15) & ~(size_t)15;
+  lock_region(region);
+
+  block_t *block = NULL;
+  chunk_t *head = (chunk_t *)region->chunks;
+  if (head != NULL && head->used + total <= head->size) {
+    block = (block_t *)((char *)head + CHUNK_HEADER + head->used);
+    head->used += total;
+  } else {
+    bool alone = total > REGION_CHUNK_SIZE / 4;
+    size_t size = (alone) ? total : REGION_CHUNK_SIZE;
+    chunk_t *chunk = (chunk_t *)system_alloc(CHUNK_HEADER + size);
+    chunk->used = total;
+    chunk->size = size;
+
+    // a block with a chunk of its own goes behind the head, which keeps
+    // serving the small ones
+    if (head != NULL && alone) {
+      chunk->next = head->next;
+      head->next = chunk;
+    } else {
+      chunk->next = head;
+      region->chunks = chunk;
+    }
+    block = (block_t *)((char *)chunk + CHUNK_HEADER);
+  }
+  unlock_region(region);
+
+  block->region = region;
+  block->size = total;
+  block->pool = POOL_CLASSES;
+  return block;
+}
+
+// only the last block of the head chunk goes back, as temporaries do
+static void region_rollback(block_t *block) {
+  region_t *region = block->region;
+  lock_region(region);
+  chunk_t *head = (chunk_t *)region->chunks;
+  if ((char *)block + block->size == (char *)head + CHUNK_HEADER + head->used) {
+    head->used -= block->size;
+  }
+  unlock_region(region);
+}
+
+void *pool_alloc(const size_t size) {
+  size_t total = size + sizeof(block_t);
+  assert(total <= UINT32_MAX);
+
+  block_t *block = NULL;
+  uint32_t pool = POOL_CLASSES;
+  if (alloc_mode == POOL_ALLOC && current_region != NULL) {
+    return region_block(current_region, total) + 1;
+  }
+  if (alloc_mode == POOL_ALLOC) {
+    pool = pool_class(total);
+  }
+
+  if (pool < POOL_CLASSES) {
+    total = (size_t)1 << (pool + MIN_BLOCK_SHIFT);
+    block = (block_t *)free_lists[pool];
+    if (block != NULL) {
+      free_lists[pool] = *(void **)(block + 1);
+      --free_counts[pool];
+      return block + 1;
+    }
+  }
+
+  block = (block_t *)system_alloc(total);
+  block->region = NULL;
+  block->size = total;
+  block->pool = pool;
+  return block + 1;
+}
+
+void *pool_realloc(void *ptr, const size_t old_size, const size_t new_size) {
+  (void)old_size;
+  if (ptr == NULL) {
+    return pool_alloc(new_size);
+  }
+
+  block_t *block = (block_t *)ptr - 1;
+  size_t capacity = block->size - sizeof(block_t);
+  if (new_size <= capacity && block->region == NULL) {
+    return ptr;
+  }
+
+  void *copy = pool_alloc(new_size);
+  memcpy(copy, ptr, (new_size < capacity) ? new_size : capacity);
+  pool_free(ptr, capacity);
+  return copy;
+}
+
+void pool_free(void *ptr, const size_t size) {
+  (void)size;
+  if (ptr == NULL) {
+    return;
+  }
+
+  block_t *block = (block_t *)ptr - 1;
+  if (block->region != NULL) {
+    region_rollback(block);
+    return;
+  }
+
+  uint32_t pool = block->pool;
+  if (pool == POOL_CLASSES || free_counts[pool] == MAX_FREE_BLOCKS) {
+    free(block);
+    return;
+  }
+
+  if (!registered) {
+    pthread_once(&release_once, make_release_key);
+    pthread_setspecific(release_key, &registered);
+    registered = true;
+  }
+  *(void **)(block + 1) = free_lists[pool];
+  free_lists[pool] = block;
+  ++free_counts[pool];
+}
+
+region_t *region_enter(region_t *region) {
+  region_t *previous = current_region;
+  current_region = region;
+  return previous;
+}
+
+void region_leave(region_t *previous) { current_region = previous; }
+
+void region_free(region_t *region) {
+  chunk_t *chunk = (chunk_t *)region->chunks;
+  while (chunk != NULL) {
+    chunk_t *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+  region->chunks = NULL;
+}
+
+void pool_release(void) {
+  for (uint32_t i = 0; i < POOL_CLASSES; ++i) {
+    while (free_lists[i] != NULL) {
+      void *block = free_lists[i];
+      free_lists[i] = *(void **)((block_t *)block + 1);
+      free(block);
+    }
+    free_counts[i] = 0;
+  }
+}
+
+#if defined(BOOST_MPZ_INT)
+// before any static integer is constructed, as GMP frees every block with the
+// function of the allocator that made it; libtommath has no such hook, only
+// macros for when the library itself is compiled, so tom keeps malloc
+__attribute__((constructor(101))) static void setup_gmp_allocator(void) {
+  mp_set_memory_functions(pool_alloc, pool_realloc, pool_free);
+}
+#endif
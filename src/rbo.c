@@ -3,7 +3,8 @@
 #include "utils.h"
 
 void inner_rbo_unrank(uint32_t *rop, const uint16_t n, const uint16_t k,
-                      const uint16_t d, const uintx r, const uint16_t start) {
+                      const uint16_t d, uintx_cref r, const uint16_t start,
+                      workspace_t *ws) {
   uintx rank = r;
 
   if (k == 1) {
@@ -17,11 +18,12 @@ void inner_rbo_unrank(uint32_t *rop, const uint16_t n, const uint16_t k,
   uint16_t leftSum = 0;
   uint16_t rightSum = 0;
   uintx rightPoints = 0;
+  uintx buffer = 0;
 
   for (uintx count = 0; leftSum <= min(n, left * d); ++leftSum, rank -= count) {
     rightSum = n - leftSum;
     rightPoints = bic(rightSum, right, d);
-    count = bic(leftSum, left, d) * rightPoints;
+    count = *bic_view(leftSum, left, d, &buffer) * rightPoints;
     if (rank < count) {
       break;
     }
@@ -30,13 +32,13 @@ void inner_rbo_unrank(uint32_t *rop, const uint16_t n, const uint16_t k,
   uintx leftRank = rank / rightPoints;
   uintx rightRank = rank % rightPoints;
 
-  inner_rbo_unrank(rop, leftSum, left, d, leftRank, start);
-  inner_rbo_unrank(rop, rightSum, right, d, rightRank, start + left);
+  inner_rbo_unrank(rop, leftSum, left, d, leftRank, start, ws);
+  inner_rbo_unrank(rop, rightSum, right, d, rightRank, start + left, ws);
 }
 
 void rbo_unrank(uint32_t *rop, const uint16_t n, const uint16_t k,
-                const uint16_t d, const uintx r) {
-  inner_rbo_unrank(rop, n, k, d, r, 0);
+                const uint16_t d, uintx_cref r, workspace_t *ws) {
+  inner_rbo_unrank(rop, n, k, d, r, 0, ws);
 }
 
 uintx rbo_rank(const uint16_t n, const uint16_t k, const uint16_t d,
@@ -61,11 +63,15 @@ uintx rbo_rank(const uint16_t n, const uint16_t k, const uint16_t d,
   }
 
   uintx case3 = 0;
+  uintx leftPoints = 0;
+  uintx rightPoints = 0;
   for (uint16_t s = 0; s < leftSum; ++s) {
-    case3 += bic(s, left, d) * bic(n - s, right, d);
+    case3 += *bic_view(s, left, d, &leftPoints) *
+             *bic_view(n - s, right, d, &rightPoints);
   }
 
-  uintx case5 = rbo_rank(leftSum, left, d, xl) * bic(rightSum, right, d);
+  uintx case5 = rbo_rank(leftSum, left, d, xl) *
+               *bic_view(rightSum, right, d, &rightPoints);
   uintx case7 = rbo_rank(rightSum, right, d, xr);
 
   return case3 + case5 + case7;
@@ -0,0 +1,129 @@
+#include "tail.h"
+#include "colex.h"
+#include "gray.h"
+#include "math.h"
+#include "pack.h"
+#include "utils.h"
+#include "workspace.h"
+
+#include <string.h>
+
+tail_t tail_cache;
+int tail_budget = 0;
+
+// number of suffixes of `parts` parts, or zero if they exceed `limit`
+static size_t tail_entries(const uint16_t n, const uint16_t parts,
+                           const uint16_t d, const size_t limit) {
+  size_t entries = 0;
+
+  for (uint16_t s = 0; s <= min(n, parts * d); ++s) {
+    entries += (size_t)inner_bic_with_sums(s, parts, d, NULL, pascal);
+    if (entries > limit) {
+      return 0;
+    }
+  }
+
+  return entries;
+}
+
+static void fill_tail(uint64_t *table, const unrank_func unrank,
+                      const uint16_t parts, uint32_t *comp, workspace_t *ws) {
+  const uint16_t d = tail_cache.d;
+
+  for (uint16_t s = 0; s <= tail_cache.max_sum; ++s) {
+    for (uint64_t r = tail_cache.offsets[s]; r < tail_cache.offsets[s + 1];
+         ++r) {
+      (*unrank)(comp, s, parts, d, (uintx)(r - tail_cache.offsets[s]), ws);
+
+      uint64_t packed = 0;
+      for (uint16_t j = parts; j > 0; --j) {
+        packed = (packed << tail_cache.bits) | comp[j - 1];
+      }
+      table[r] = packed;
+    }
+  }
+}
+
+void build_tail(const uint16_t n, const uint16_t k, const uint16_t d) {
+  free_tail();
+  if (tail_budget == 0) {
+    return;
+  }
+  tail_cache.budget = tail_budget;
+  tail_cache.n = n;
+  tail_cache.d = d;
+
+  const uint8_t bits = part_bits(d, BIT_FORMAT);
+  const size_t limit = (size_t)tail_budget * 1024 / (2 * sizeof(uint64_t));
+
+  // a single part is the remaining sum itself, so start from two
+  uint16_t parts = 0;
+  size_t entries = 0;
+  for (uint16_t p = 2; p < k && p * bits <= 64; ++p) {
+    size_t more = tail_entries(n, p, d, limit);
+    if (more == 0) {
+      break;
+    }
+    parts = p;
+    entries = more;
+  }
+  if (parts == 0) {
+    return;
+  }
+
+  const uint16_t max_sum = min(n, parts * d);
+  tail_cache.total_size = (max_sum + 2 + 2 * entries) * sizeof(uint64_t);
+  tail_cache.offsets = (uint64_t *)malloc(tail_cache.total_size);
+  assert(tail_cache.offsets != NULL);
+  tail_cache.colex = tail_cache.offsets + max_sum + 2;
+  tail_cache.gray = tail_cache.colex + entries;
+
+  tail_cache.offsets[0] = 0;
+  for (uint16_t s = 0; s <= max_sum; ++s) {
+    tail_cache.offsets[s + 1] =
+        tail_cache.offsets[s] +
+        (uint64_t)inner_bic_with_sums(s, parts, d, NULL, pascal);
+  }
+
+  tail_cache.max_sum = max_sum;
+  tail_cache.bits = bits;
+
+  workspace_t ws;
+  setup_workspace(&ws, max_sum, parts, d);
+  uint32_t *comp = (uint32_t *)calloc(parts, sizeof(uint32_t));
+  assert(comp != NULL);
+
+  // `tail_cache.parts` stays zero until the tables are complete, so that the
+  // unranking that fills them does not look them up
+  fill_tail(tail_cache.colex, colex_unrank, parts, comp, &ws);
+  fill_tail(tail_cache.gray, gray_unrank, parts, comp, &ws);
+  tail_cache.parts = parts;
+
+  free(comp);
+  free_workspace(&ws);
+}
+
+void grow_tail(const uint16_t n, const uint16_t k, const uint16_t d) {
+  // smaller sums and more parts than the tables were built for fall back to
+  // scanning the levels above them
+  if (tail_cache.budget == tail_budget &&
+      tail_cache.d == d && n <= tail_cache.n && tail_cache.parts < k) {
+    return;
+  }
+  build_tail(n, k, d);
+}
+
+void free_tail(void) {
+  free(tail_cache.offsets);
+  memset((void *)&tail_cache, 0, sizeof(tail_t));
+}
+
+void tail_unrank(uint32_t *rop, const uint64_t *table, const uint16_t n,
+                 uintx_cref r) {
+  uint64_t packed = table[tail_cache.offsets[n] + (uint64_t)r];
+  const uint64_t mask = (1ULL << tail_cache.bits) - 1;
+
+  for (uint16_t j = 0; j < tail_cache.parts; ++j, packed >>= tail_cache.bits) {
+    rop[j] = (uint32_t)(packed & mask);
+  }
+}
@@ -1,6 +1,15 @@
+#if !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include "utils.h"
 #include "math.h"
 
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 uint64_t cycles(void) {
   uint64_t result = 0;
   __asm volatile(".byte 15;.byte 49;shlq $32,%%rdx;orq %%rdx,%%rax"
@@ -8,10 +17,53 @@ uint64_t cycles(void) {
   return result;
 }
 
+static int32_t open_read_misses(const uint64_t cache) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.size = sizeof(attr);
+  attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return (int32_t)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int32_t open_dtlb_misses(void) {
+  return open_read_misses(PERF_COUNT_HW_CACHE_DTLB);
+}
+
+int32_t open_l1d_misses(void) {
+  return open_read_misses(PERF_COUNT_HW_CACHE_L1D);
+}
+
+int64_t read_misses(const int32_t fd) {
+  uint64_t count = 0;
+  if (fd < 0 || read(fd, &count, sizeof(count)) != sizeof(count)) {
+    return -1;
+  }
+  return (int64_t)count;
+}
+
+void close_misses(const int32_t fd) {
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
 uint32_t min(const uint32_t a, const uint32_t b) { return (a < b) ? a : b; }
 
 int32_t max(const int32_t a, const int32_t b) { return (a > b) ? a : b; }
 
+void setup_part_iter(part_iter_t *it, const uint16_t n, const uint16_t k,
+                     const uint16_t d, uintx_cref r) {
+  it->rank = r;
+  it->it_n = n;
+  it->d = d;
+  it->remaining = k;
+}
+
 void check_valid_bounded_composition(const uint32_t *c, const uint16_t n,
                                      const uint16_t k, const uint16_t d) {
   uint32_t sum = 0;
@@ -58,7 +110,7 @@ size_t bsearch_insertion(const void *key, const void *base, size_t nel,
 
 bool bic_geq_2_pow_m(const uint16_t m, const uint16_t n, const uint16_t k,
                      const uint16_t d) {
-  return (bool)(inner_bic_with_sums(n, k, d, NULL, inner_bin) >> m);
+  return (bool)(inner_bic_with_sums(n, k, d, NULL, pascal) >> m);
 }
 
 static void linear_search(uint16_t *rop, const uint16_t lo, const uint16_t hi,
@@ -0,0 +1,40 @@
+#include "workspace.h"
+#include "digest.h"
+#include "math.h"
+#include "utils.h"
+
+#include <assert.h>
+
+void setup_workspace(workspace_t *ws, const uint16_t n, const uint16_t k,
+                     const uint16_t d) {
+  // as many alternating terms as the first level of inner_bic_with_sums
+  size_t terms = min(k, n / (d + 1)) + 1;
+  ws->partial_sums = (intx *)calloc(terms, sizeof(intx));
+  assert(ws->partial_sums != NULL);
+
+  // an accumulated row of #C(n, k, d), see inner_acc
+  size_t length = d + 3;
+  ws->sums = (uintx *)calloc(length, sizeof(uintx));
+  assert(ws->sums != NULL);
+
+  setup_modulus(ws, n, k, d);
+
+  ws->bytes_length = ws->modulus_bits / sizeof(uint64_t);
+  ws->bytes_length += (ws->bytes_length == 0);
+  ws->bytes = (uint8_t *)calloc(ws->bytes_length, sizeof(uint8_t));
+  assert(ws->bytes != NULL);
+
+  // a wide composition to convert from and to narrower formats
+  ws->parts = (uint32_t *)calloc(k, sizeof(uint32_t));
+  assert(ws->parts != NULL);
+
+  ws->total_size = terms * sizeof(intx) + length * sizeof(uintx) +
+                   ws->bytes_length * sizeof(uint8_t) + k * sizeof(uint32_t);
+}
+
+void free_workspace(workspace_t *ws) {
+  free(ws->partial_sums);
+  free(ws->sums);
+  free(ws->bytes);
+  free(ws->parts);
+}